@@ -1,1274 +1,7852 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <iomanip>
-#include <algorithm>
-#include <map>
-#include <stdexcept>
-#include <sstream>
-#include <limits>
-#include <fstream>
-#include <cstdlib>
-using namespace std;
-
-const double TICKET_PRICE_STANDARD = 250.00;
-const double TICKET_PRICE_PREMIUM = 450.00;
-const string APP_NAME = "CineSphere Booking Console";
-const string LINE_SEPARATOR = string(70, '-');
-const string BOOKING_DATA_FILE = "bookings.txt";
-
-void printHeader(const string &title)
-{
-    cout << "\n"
-         << string(10, '=') << " " << title << " " << string(10, '=') << endl;
-}
-
-int getValidatedIntInput(const string &prompt)
-{
-    int input;
-    while (true)
-    {
-        cout << prompt;
-        if (cin >> input)
-        {
-            if (cin.peek() == '\n')
-            {
-                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                return input;
-            }
-        }
-        cout << "Invalid input. Please enter a valid number." << endl;
-        cin.clear();
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-    }
-}
-
-string formatCurrency(double amount)
-{
-    stringstream ss;
-    ss << fixed << setprecision(2) << amount;
-    return ss.str();
-}
-
-void clearScreen()
-{
-#ifdef _WIN32
-    system("cls");
-#else
-    system("clear");
-#endif
-}
-
-
-class Product
-{
-protected:
-    string name;
-    double price;
-
-public:
-    Product(string n, double p) : name(n), price(p) {}
-
-    
-    virtual void displayInfo() const = 0;
-
-  
-    virtual ~Product() {}
-
-  
-    string getName() const { return name; }
-    double getPrice() const { return price; }
-};
-
-
-class MenuItem : public Product
-{
-private:
-    string category;
-
-public:
-    MenuItem(string n, double p, string c)
-        : Product(n, p), category(c) {}
-
-    string getCategory() const { return category; }
-
-
-    void displayInfo() const override
-    {
-        cout << "  " << left << setw(30) << name
-             << " - " << left << setw(10) << category
-             << " @ Rs " << formatCurrency(price) << endl;
-    }
-
-    void displayItem(int index) const
-    {
-        cout << "  [" << index << "] ";
-        displayInfo();
-    }
-};
-
-
-class Seat
-{
-public:
-    enum Status
-    {
-        AVAILABLE,
-        BOOKED,
-        SELECTED
-    };
-    enum Type
-    {
-        STANDARD,
-        PREMIUM
-    };
-
-private:
-    string seatId;
-    Status status;
-    Type type;
-
-public:
-    Seat(string id, Type t) : seatId(id), status(AVAILABLE), type(t) {}
-
-    
-    string getId() const { return seatId; }
-    Status getStatus() const { return status; }
-    Type getType() const { return type; }
-    double getPrice() const { return (type == PREMIUM ? TICKET_PRICE_PREMIUM : TICKET_PRICE_STANDARD); }
-
-    string getStatusString() const
-    {
-        if (status == BOOKED)
-            return "BOOKED";
-        if (status == SELECTED)
-            return "SELECTED";
-        return "AVAILABLE";
-    }
-
-    void setStatus(Status newStatus)
-    {
-        status = newStatus;
-    }
-
-    void displaySeat() const
-    {
-        string displayChar = (type == PREMIUM ? "P" : "S");
-        if (status == BOOKED)
-        {
-            displayChar = "X";
-        }
-        else if (status == SELECTED)
-        {
-            displayChar = "V";
-        }
-        cout << "[" << displayChar << setw(4) << right << seatId << "]";
-    }
-};
-
-
-
-class Entertainment
-{
-protected:
-    string title;
-    string genre;
-    int durationMinutes;
-
-public:
-    Entertainment(string t, string g, int d)
-        : title(t), genre(g), durationMinutes(d) {}
-
-    virtual ~Entertainment() {}
-
-   
-    virtual void displayDetails(int index) const
-    {
-        cout << "  [" << index << "] " << left << setw(40) << title
-             << " (" << genre << ", " << durationMinutes << " mins)" << endl;
-    }
-
-    string getTitle() const { return title; }
-    int getDuration() const { return durationMinutes; }
-    string getGenre() const { return genre; }
-};
-
-
-class Movie : public Entertainment
-{
-private:
-    string director;
-    string language;
-
-public:
-    Movie(string t, string g, int d, string dir = "Unknown", string lang = "English")
-        : Entertainment(t, g, d), director(dir), language(lang) {}
-
-   
-    void displayDetails(int index) const override
-    {
-        cout << "  [" << index << "] " << left << setw(40) << title
-             << " (" << genre << ", " << durationMinutes << " mins, " << language << ")" << endl;
-    }
-
-    string getDirector() const { return director; }
-    string getLanguage() const { return language; }
-};
-
-
-class PriceCalculator;
-
-class FoodOrder
-{
-private:
-    map<string, pair<int, double>> orderItems;
-    double totalFoodPrice;
-
-public:
-    FoodOrder() : totalFoodPrice(0.0) {}
-
-    void addItem(const MenuItem &item, int quantity)
-    {
-        if (quantity <= 0)
-            return;
-
-        if (orderItems.count(item.getName()))
-        {
-            int currentQty = orderItems[item.getName()].first;
-            orderItems[item.getName()].first = currentQty + quantity;
-        }
-        else
-        {
-            orderItems[item.getName()] = {quantity, item.getPrice()};
-        }
-        totalFoodPrice += item.getPrice() * quantity;
-    }
-
-    double getTotalPrice() const
-    {
-        return totalFoodPrice;
-    }
-
-    bool isEmpty() const
-    {
-        return orderItems.empty();
-    }
-
-    void displayOrder() const
-    {
-        cout << "\n    --- Food Order Details ---" << endl;
-        if (isEmpty())
-        {
-            cout << "    (No food items ordered)" << endl;
-            return;
-        }
-        for (const auto &entry : orderItems)
-        {
-            const string &name = entry.first;
-            int quantity = entry.second.first;
-            double pricePerItem = entry.second.second;
-            double subtotal = quantity * pricePerItem;
-
-            cout << "    * " << left << setw(30) << name
-                 << " x" << setw(3) << right << quantity
-                 << " @ Rs " << formatCurrency(pricePerItem)
-                 << " = Rs " << formatCurrency(subtotal) << endl;
-        }
-        cout << "    Total Food Cost: Rs " << formatCurrency(totalFoodPrice) << endl;
-    }
-
-    friend class PriceCalculator;
-    friend double calculateDiscount(const FoodOrder &order, double discountPercent);
-};
-
-
-double calculateDiscount(const FoodOrder &order, double discountPercent)
-{
-
-    return order.totalFoodPrice*(discountPercent / 100.0);
-}
-
-
-class Location
-{
-protected:
-    string name;
-    string city;
-    string state;
-
-public:
-    Location(string n, string c, string s) : name(n), city(c), state(s) {}
-
-    virtual ~Location() {}
-
-   
-    virtual void displayLocationInfo() const = 0;
-
-    string getName() const { return name; }
-    string getCity() const { return city; }
-    string getState() const { return state; }
-};
-
-
-class Theater : public Location
-{
-private:
-    vector<MenuItem> menu;
-    vector<vector<Seat>> seatMap;
-    int theaterCapacity;
-
-    void initializeSeatMap(int standardRows, int premiumRows, int seatsPerRow)
-    {
-        char currentRow = 'A';
-        theaterCapacity = 0;
-
-        for (int r = 0; r < premiumRows; ++r)
-        {
-            vector<Seat> row;
-            for (int c = 1; c <= seatsPerRow; ++c)
-            {
-                string seatId = string(1, currentRow) + to_string(c);
-                row.emplace_back(seatId, Seat::PREMIUM);
-                theaterCapacity++;
-            }
-            seatMap.push_back(row);
-            currentRow++;
-        }
-
-        for (int r = 0; r < standardRows; ++r)
-        {
-            vector<Seat> row;
-            for (int c = 1; c <= seatsPerRow; ++c)
-            {
-                string seatId = string(1, currentRow) + to_string(c);
-                row.emplace_back(seatId, Seat::STANDARD);
-                theaterCapacity++;
-            }
-            seatMap.push_back(row);
-            currentRow++;
-        }
-    }
-
-    void initializeMenu()
-    {
-        menu.emplace_back("Caramel Popcorn (Large)", 350.00, "Popcorn");
-        menu.emplace_back("Salty Popcorn (Medium)", 250.00, "Popcorn");
-        menu.emplace_back("Coca-Cola (500ml)", 150.00, "Beverage");
-        menu.emplace_back("Fresh Lime Soda", 180.00, "Beverage");
-        menu.emplace_back("Nachos with Cheese Dip", 290.00, "Snack");
-        menu.emplace_back("Veg Burger", 220.00, "Snack");
-    }
-
-public:
-    Theater(string n, string c, string s, int stdRows, int premRows, int seatsPer)
-        : Location(n, c, s), theaterCapacity(0)
-    {
-        initializeSeatMap(stdRows, premRows, seatsPer);
-        initializeMenu();
-    }
-
-  
-    void displayLocationInfo() const override
-    {
-        cout << "Theater: " << name << " | City: " << city
-             << " | State: " << state << " | Capacity: " << theaterCapacity << " seats" << endl;
-    }
-
-    const vector<MenuItem> &getMenu() const { return menu; }
-    vector<vector<Seat>> &getSeatMap() { return seatMap; }
-    const vector<vector<Seat>> &getConstSeatMap() const { return seatMap; }
-    int getCapacity() const { return theaterCapacity; }
-
-    void displayDetails(int index) const
-    {
-        cout << "  [" << index << "] " << name << ", " << city << endl;
-    }
-
-   
-    friend class PriceCalculator;
-};
-
-class Showtime
-{
-private:
-    const Movie &movie;
-    Theater &theater;
-    string time;
-    string date;
-    string uniqueShowId;
-
-    string createUniqueId() const
-    {
-        return theater.getName() + "|" + date + "|" + time + "|" + movie.getTitle();
-    }
-
-public:
-    Showtime(const Movie &m, Theater &t, string tm, string d)
-        : movie(m), theater(t), time(tm), date(d)
-    {
-        uniqueShowId = createUniqueId();
-    }
-
-    const Movie &getMovie() const { return movie; }
-    Theater &getTheater() const { return theater; }
-    string getTime() const { return time; }
-    string getDate() const { return date; }
-    string getUniqueShowId() const { return uniqueShowId; }
-
-    void displayDetails(int index) const
-    {
-        cout << "  [" << index << "] ";
-        cout << left << setw(10) << time;
-        cout << " - " << left << setw(30) << movie.getTitle();
-        cout << " (" << movie.getDuration() << " mins) on " << date << endl;
-    }
-};
-
-
-class PriceCalculator
-{
-public:
-    
-    static double calculateTotalRevenue(const Theater &theater, const FoodOrder &order)
-    {
-        int bookedSeats = 0;
-        double ticketRevenue = 0.0;
-
-        for (const auto &row : theater.seatMap)
-        {
-            for (const auto &seat : row)
-            {
-                if (seat.getStatus() == Seat::BOOKED)
-                {
-                    bookedSeats++;
-                    ticketRevenue += seat.getPrice();
-                }
-            }
-        }
-
-        // Access private member of FoodOrder
-        double foodRevenue = order.totalFoodPrice;
-
-        return ticketRevenue + foodRevenue;
-    }
-
-    static double calculateOccupancyRate(const Theater &theater)
-    {
-        int bookedSeats = 0;
-        int totalSeats = theater.theaterCapacity;
-
-        for (const auto &row : theater.seatMap)
-        {
-            for (const auto &seat : row)
-            {
-                if (seat.getStatus() == Seat::BOOKED)
-                {
-                    bookedSeats++;
-                }
-            }
-        }
-
-        return totalSeats > 0 ? (bookedSeats * 100.0) / totalSeats : 0.0;
-    }
-};
-
-class Booking
-{
-private:
-    static int nextBookingId;
-    int bookingId;
-    const Showtime *showtimePtr;
-    vector<string> bookedSeatIds;
-    FoodOrder foodOrder;
-    double ticketTotal;
-    double grandTotal;
-    double appliedDiscount;
-
-    void calculateTicketTotal(Theater &theater)
-    {
-        ticketTotal = 0.0;
-        const auto &seatMap = theater.getConstSeatMap();
-        for (const string &seatId : bookedSeatIds)
-        {
-            for (const auto &row : seatMap)
-            {
-                for (const auto &seat : row)
-                {
-                    if (seat.getId() == seatId)
-                    {
-                        ticketTotal += seat.getPrice();
-                        goto seat_found;
-                    }
-                }
-            }
-        seat_found:;
-        }
-
-      
-        appliedDiscount = 0.0;
-        if (foodOrder.getTotalPrice() > 500.0)
-        {
-            appliedDiscount = calculateDiscount(foodOrder, 10.0);
-        }
-
-        grandTotal = ticketTotal + foodOrder.getTotalPrice() - appliedDiscount;
-    }
-
-public:
-    Booking(const Showtime &s, const vector<string> &seats, const FoodOrder &order)
-        : showtimePtr(&s), bookedSeatIds(seats), foodOrder(order), appliedDiscount(0.0)
-    {
-        bookingId = nextBookingId++;
-        calculateTicketTotal(s.getTheater());
-    }
-
-    Booking(int id, const Showtime &s, const vector<string> &seats)
-        : showtimePtr(&s), bookedSeatIds(seats), foodOrder({}), appliedDiscount(0.0)
-    {
-        bookingId = id;
-        calculateTicketTotal(s.getTheater());
-
-        if (id >= nextBookingId)
-        {
-            nextBookingId = id + 1;
-        }
-    }
-
-    int getId() const { return bookingId; }
-    const Showtime &getShowtime() const { return *showtimePtr; }
-    const vector<string> &getBookedSeatIds() const { return bookedSeatIds; }
-
-    void generateBill() const
-    {
-        printHeader("BOOKING CONFIRMATION & BILL");
-        cout << "Reference ID: " << bookingId << endl;
-        cout << LINE_SEPARATOR << endl;
-
-        cout << left << setw(20) << "Movie:" << getShowtime().getMovie().getTitle() << endl;
-        cout << left << setw(20) << "Theater:" << getShowtime().getTheater().getName()
-             << " (" << getShowtime().getTheater().getCity() << ")" << endl;
-        cout << left << setw(20) << "Show Time:" << getShowtime().getDate() << " at " << getShowtime().getTime() << endl;
-        cout << LINE_SEPARATOR << endl;
-
-        cout << "Ticket Details:" << endl;
-        cout << "  Seats Reserved (" << bookedSeatIds.size() << "): ";
-        for (size_t i = 0; i < bookedSeatIds.size(); ++i)
-        {
-            cout << bookedSeatIds[i] << (i < bookedSeatIds.size() - 1 ? ", " : "");
-        }
-        cout << endl;
-        cout << left << setw(20) << "  Ticket Subtotal:" << "Rs " << formatCurrency(ticketTotal) << endl;
-
-        foodOrder.displayOrder();
-
-        if (appliedDiscount > 0.0)
-        {
-            cout << "\n    ** SPECIAL DISCOUNT APPLIED (10% on Food) **" << endl;
-            cout << "    Discount Amount: Rs " << formatCurrency(appliedDiscount) << endl;
-        }
-
-        cout << LINE_SEPARATOR << endl;
-        cout << ">> " << left << setw(20) << "GRAND TOTAL:" << "Rs " << formatCurrency(grandTotal) << endl;
-        cout << LINE_SEPARATOR << endl;
-
-        double occupancy = PriceCalculator::calculateOccupancyRate(getShowtime().getTheater());
-        cout << "Theater Occupancy: " << fixed << setprecision(1) << occupancy << "%" << endl;
-        cout << "Enjoy your movie! Seats are confirmed." << endl;
-    }
-
-    void cancel() const
-    {
-        Theater &theater = getShowtime().getTheater();
-        auto &seatMap = theater.getSeatMap();
-
-        for (const string &seatId : bookedSeatIds)
-        {
-            for (auto &row : seatMap)
-            {
-                for (auto &seat : row)
-                {
-                    if (seat.getId() == seatId && seat.getStatus() == Seat::BOOKED)
-                    {
-                        seat.setStatus(Seat::AVAILABLE);
-                        break;
-                    }
-                }
-            }
-        }
-    }
-
-    string toFileString() const
-    {
-        string seatList;
-        for (size_t i = 0; i < bookedSeatIds.size(); ++i)
-        {
-            seatList += bookedSeatIds[i];
-            if (i < bookedSeatIds.size() - 1)
-            {
-                seatList += ",";
-            }
-        }
-        return to_string(bookingId) + "|" + getShowtime().getUniqueShowId() + "|" + seatList;
-    }
-
-    void displayBriefDetails() const
-    {
-        cout << "  [ID: " << bookingId << "] "
-             << getShowtime().getMovie().getTitle()
-             << " at " << getShowtime().getTime()
-             << " on " << getShowtime().getDate()
-             << " (" << getShowtime().getTheater().getName() << ")" << endl;
-        cout << "    Seats: ";
-        for (size_t i = 0; i < bookedSeatIds.size(); ++i)
-        {
-            cout << bookedSeatIds[i] << (i < bookedSeatIds.size() - 1 ? ", " : "");
-        }
-        cout << endl;
-    }
-};
-
-int Booking::nextBookingId = 5001;
-
-class SystemManager
-{
-private:
-    vector<Movie> movies;
-    vector<Theater> theaters;
-    vector<Showtime> showtimes;
-    vector<Booking> allBookings;
-    vector<string> states;
-
-    void initializeData()
-    {
-        states = {"Maharashtra", "Karnataka", "Delhi", "Tamil Nadu", "West Bengal", "Gujarat", "Uttar Pradesh"};
-
-        movies.emplace_back("The AI Architect", "Sci-Fi/Action", 145, "James Cameron", "English");
-        movies.emplace_back("Eternal Sun", "Romantic Drama", 120, "Sofia Coppola", "Hindi");
-        movies.emplace_back("Rogue Agent 7", "Spy Thriller", 130, "Christopher Nolan", "English");
-        movies.emplace_back("Jungle Quest", "Family Animation", 95, "Pete Docter", "Hindi");
-        movies.emplace_back("Desert Storm", "War Epic", 160, "Ridley Scott", "English");
-        movies.emplace_back("The Last Voyage", "Mystery", 110, "Denis Villeneuve", "English");
-
-        theaters.emplace_back("PVR Phoenix", "Mumbai", "Maharashtra", 6, 4, 10);
-        theaters.emplace_back("Cinepolis Amanora", "Pune", "Maharashtra", 5, 5, 8);
-        theaters.emplace_back("INOX Empress", "Nagpur", "Maharashtra", 7, 3, 12);
-
-        theaters.emplace_back("Gopalan Cinemas", "Bangalore", "Karnataka", 5, 5, 10);
-        theaters.emplace_back("PVR Orion Mall", "Mysore", "Karnataka", 4, 6, 9);
-
-        theaters.emplace_back("Wave Cinemas", "New Delhi", "Delhi", 5, 5, 10);
-        theaters.emplace_back("PVR Ambience", "Gurugram", "Delhi", 6, 4, 11);
-        theaters.emplace_back("INOX Mall", "Noida", "Delhi", 7, 3, 9);
-
-        theaters.emplace_back("Jazz Cinemas", "Chennai", "Tamil Nadu", 5, 5, 11);
-        theaters.emplace_back("Brookfield Mall", "Coimbatore", "Tamil Nadu", 6, 4, 9);
-
-        theaters.emplace_back("Inox South City", "Kolkata", "West Bengal", 7, 3, 10);
-        theaters.emplace_back("PVR City Centre", "Siliguri", "West Bengal", 5, 5, 8);
-
-        theaters.emplace_back("PVR Acropolis", "Ahmedabad", "Gujarat", 6, 4, 10);
-        theaters.emplace_back("Cinepolis VR", "Surat", "Gujarat", 5, 5, 12);
-        theaters.emplace_back("Inox Inorbit", "Vadodara", "Gujarat", 4, 6, 9);
-
-        theaters.emplace_back("Wave Mall", "Lucknow", "Uttar Pradesh", 7, 3, 10);
-        theaters.emplace_back("PVR Rave 3", "Kanpur", "Uttar Pradesh", 5, 5, 11);
-        theaters.emplace_back("INOX Pacific", "Agra", "Uttar Pradesh", 6, 4, 8);
-
-        showtimes.emplace_back(movies[0], theaters[0], "10:30 AM", "2025-12-15");
-        showtimes.emplace_back(movies[1], theaters[0], "07:00 PM", "2025-12-15");
-        showtimes.emplace_back(movies[4], theaters[1], "04:00 PM", "2025-12-15");
-        showtimes.emplace_back(movies[5], theaters[1], "09:30 PM", "2025-12-15");
-        showtimes.emplace_back(movies[5], theaters[2], "01:00 PM", "2025-12-16");
-
-        showtimes.emplace_back(movies[2], theaters[3], "11:00 AM", "2025-12-16");
-        showtimes.emplace_back(movies[0], theaters[3], "05:00 PM", "2025-12-16");
-        showtimes.emplace_back(movies[1], theaters[4], "09:00 PM", "2025-12-16");
-        showtimes.emplace_back(movies[3], theaters[4], "02:00 PM", "2025-12-16");
-
-        showtimes.emplace_back(movies[3], theaters[5], "02:00 PM", "2025-12-17");
-        showtimes.emplace_back(movies[5], theaters[6], "06:00 PM", "2025-12-17");
-        showtimes.emplace_back(movies[4], theaters[7], "08:30 PM", "2025-12-17");
-        showtimes.emplace_back(movies[1], theaters[7], "11:00 AM", "2025-12-17");
-
-        showtimes.emplace_back(movies[1], theaters[8], "10:00 AM", "2025-12-18");
-        showtimes.emplace_back(movies[0], theaters[8], "06:45 PM", "2025-12-18");
-        showtimes.emplace_back(movies[2], theaters[9], "03:00 PM", "2025-12-18");
-
-        showtimes.emplace_back(movies[0], theaters[10], "12:00 PM", "2025-12-19");
-        showtimes.emplace_back(movies[3], theaters[11], "08:00 PM", "2025-12-19");
-
-        showtimes.emplace_back(movies[5], theaters[12], "04:30 PM", "2025-12-20");
-        showtimes.emplace_back(movies[2], theaters[13], "07:30 PM", "2025-12-20");
-        showtimes.emplace_back(movies[4], theaters[14], "01:00 PM", "2025-12-20");
-
-        showtimes.emplace_back(movies[0], theaters[15], "06:00 PM", "2025-12-21");
-        showtimes.emplace_back(movies[1], theaters[16], "10:00 AM", "2025-12-21");
-        showtimes.emplace_back(movies[3], theaters[17], "02:30 PM", "2025-12-21");
-
-        loadBookingData();
-    }
-
-    void saveBookingData() const
-    {
-        ofstream outFile(BOOKING_DATA_FILE);
-        if (outFile.is_open())
-        {
-            for (const auto &booking : allBookings)
-            {
-                outFile << booking.toFileString() << "\n";
-            }
-            outFile.close();
-        }
-        else
-        {
-            cout << "\n[System Error] Unable to save booking data to file: " << BOOKING_DATA_FILE << endl;
-        }
-    }
-
-    void loadBookingData()
-    {
-        ifstream inFile(BOOKING_DATA_FILE);
-        string line;
-        if (!inFile.is_open())
-        {
-            return;
-        }
-
-        int loadedCount = 0;
-        while (getline(inFile, line))
-        {
-            stringstream ss(line);
-            string segment;
-            vector<string> parts;
-            while (getline(ss, segment, '|'))
-            {
-                parts.push_back(segment);
-            }
-
-            if (parts.size() == 3)
-            {
-                try
-                {
-                    int bookingId = stoi(parts[0]);
-                    string uniqueShowId = parts[1];
-                    string seatsString = parts[2];
-
-                    Showtime *foundShowtime = nullptr;
-                    for (auto &show : showtimes)
-                    {
-                        if (show.getUniqueShowId() == uniqueShowId)
-                        {
-                            foundShowtime = &show;
-                            break;
-                        }
-                    }
-
-                    if (foundShowtime)
-                    {
-                        vector<string> bookedSeats;
-                        stringstream seatSs(seatsString);
-                        string seatId;
-                        while (getline(seatSs, seatId, ','))
-                        {
-                            bookedSeats.push_back(seatId);
-
-                            Theater &theater = foundShowtime->getTheater();
-                            for (auto &row : theater.getSeatMap())
-                            {
-                                for (auto &seat : row)
-                                {
-                                    if (seat.getId() == seatId)
-                                    {
-                                        seat.setStatus(Seat::BOOKED);
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-
-                        allBookings.emplace_back(bookingId, *foundShowtime, bookedSeats);
-                        loadedCount++;
-                    }
-                }
-                catch (const std::exception &e)
-                {
-                    cerr << "[System Error] Error processing booking line: " << line << " (" << e.what() << ")" << endl;
-                }
-            }
-        }
-        inFile.close();
-    }
-
-    FoodOrder selectFoodItems(Theater &selectedTheater)
-    {
-        FoodOrder order;
-        int foodChoice;
-        int quantity;
-        const auto &menu = selectedTheater.getMenu();
-
-        printHeader("STEP 4: Select Food & Beverages (Optional)");
-        cout << "You are ordering from the menu of " << selectedTheater.getName() << "." << endl;
-        cout << "** Spend over Rs 500 on food to get 10% discount! **" << endl;
-
-        do
-        {
-            cout << "\n"
-                 << LINE_SEPARATOR << endl;
-            cout << "Menu: " << endl;
-            for (size_t i = 0; i < menu.size(); ++i)
-            {
-                menu[i].displayItem(i + 1);
-            }
-            cout << LINE_SEPARATOR << endl;
-            cout << "[0] Proceed to Payment (Skip Food / Finish Order)" << endl;
-
-            foodChoice = getValidatedIntInput("Enter menu number to add, or 0 to continue: ");
-
-            if (foodChoice >= 1 && foodChoice <= (int)menu.size())
-            {
-                quantity = getValidatedIntInput("Enter quantity for " + menu[foodChoice - 1].getName() + ": ");
-                order.addItem(menu[foodChoice - 1], quantity);
-                cout << "-> Added " << quantity << " x " << menu[foodChoice - 1].getName() << " to your order." << endl;
-                order.displayOrder();
-
-                // Show potential discount
-                if (order.getTotalPrice() > 500.0)
-                {
-                    cout << "\n    ** You qualify for 10% food discount! **" << endl;
-                }
-            }
-            else if (foodChoice != 0)
-            {
-                cout << "Invalid menu number. Please select from 1 to " << menu.size() << "." << endl;
-            }
-        } while (foodChoice != 0);
-
-        return order;
-    }
-
-    vector<string> selectSeats(Showtime &selectedShowtime)
-    {
-        Theater &theater = selectedShowtime.getTheater();
-        auto &seatMap = theater.getSeatMap();
-        vector<string> selectedSeatIds;
-        string seatIdInput;
-        bool done = false;
-
-        printHeader("STEP 3: Select Seats");
-        cout << "Theater: " << theater.getName() << " | Movie: " << selectedShowtime.getMovie().getTitle()
-             << " | Time: " << selectedShowtime.getTime() << endl;
-        cout << "Legend: [S=Standard, P=Premium, X=Booked, V=Selected]" << endl;
-        cout << "Standard Price: Rs " << formatCurrency(TICKET_PRICE_STANDARD)
-             << " | Premium Price: Rs " << formatCurrency(TICKET_PRICE_PREMIUM) << endl;
-
-        while (!done)
-        {
-            cout << LINE_SEPARATOR << endl;
-
-            for (const auto &row : seatMap)
-            {
-                cout << "Row " << row[0].getId()[0] << " | ";
-                for (const auto &seat : row)
-                {
-                    seat.displaySeat();
-                }
-                cout << endl;
-            }
-            cout << LINE_SEPARATOR << endl;
-
-            cout << "Enter Seat ID to select/deselect (e.g., A1, P5, C10), or type 'DONE' to finish: ";
-            if (!(cin >> seatIdInput))
-            {
-                cin.clear();
-                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-                cout << "Error reading input." << endl;
-                continue;
-            }
-
-            transform(seatIdInput.begin(), seatIdInput.end(), seatIdInput.begin(), ::toupper);
-
-            if (seatIdInput == "DONE")
-            {
-                if (selectedSeatIds.empty())
-                {
-                    cout << "Please select at least one seat before proceeding." << endl;
-                    continue;
-                }
-                done = true;
-                break;
-            }
-
-            bool found = false;
-            for (auto &row : seatMap)
-            {
-                for (auto &seat : row)
-                {
-                    if (seat.getId() == seatIdInput)
-                    {
-                        found = true;
-                        if (seat.getStatus() == Seat::AVAILABLE)
-                        {
-                            seat.setStatus(Seat::SELECTED);
-                            selectedSeatIds.push_back(seat.getId());
-                            cout << "-> Seat " << seatIdInput << " selected. Current Selections: ";
-                            for (const auto &id : selectedSeatIds)
-                                cout << id << " ";
-                            cout << endl;
-                        }
-                        else if (seat.getStatus() == Seat::SELECTED)
-                        {
-                            seat.setStatus(Seat::AVAILABLE);
-                            selectedSeatIds.erase(remove(selectedSeatIds.begin(), selectedSeatIds.end(), seatIdInput), selectedSeatIds.end());
-                            cout << "-> Seat " << seatIdInput << " deselected. Current Selections: ";
-                            for (const auto &id : selectedSeatIds)
-                                cout << id << " ";
-                            cout << endl;
-                        }
-                        else
-                        {
-                            cout << "Seat " << seatIdInput << " is already BOOKED (X). Select another seat." << endl;
-                        }
-                        goto seat_selection_next_input;
-                    }
-                }
-            }
-
-            if (!found)
-            {
-                cout << "Invalid Seat ID: " << seatIdInput << ". Please check the map and try again." << endl;
-            }
-
-        seat_selection_next_input:;
-        }
-
-        for (auto &row : seatMap)
-        {
-            for (auto &seat : row)
-            {
-                if (seat.getStatus() == Seat::SELECTED)
-                {
-                    seat.setStatus(Seat::BOOKED);
-                }
-            }
-        }
-
-        return selectedSeatIds;
-    }
-
-    string selectLocation()
-    {
-        int stateChoice, cityChoice;
-        string selectedState, selectedCity;
-
-        printHeader("STEP 1.1: Select Location (State)");
-        for (size_t i = 0; i < states.size(); ++i)
-        {
-            cout << "[" << i + 1 << "] " << states[i] << endl;
-        }
-
-        while (true)
-        {
-            stateChoice = getValidatedIntInput("Enter State number: ");
-            if (stateChoice >= 1 && stateChoice <= (int)states.size())
-            {
-                selectedState = states[stateChoice - 1];
-                cout << "-> Selected State: " << selectedState << endl;
-                break;
-            }
-            cout << "Invalid state selection." << endl;
-        }
-
-        vector<string> cities;
-        for (const auto &theater : theaters)
-        {
-            if (theater.getState() == selectedState)
-            {
-                if (find(cities.begin(), cities.end(), theater.getCity()) == cities.end())
-                {
-                    cities.push_back(theater.getCity());
-                }
-            }
-        }
-
-        printHeader("STEP 1.2: Select Location (City)");
-        for (size_t i = 0; i < cities.size(); ++i)
-        {
-            cout << "[" << i + 1 << "] " << cities[i] << endl;
-        }
-
-        while (true)
-        {
-            cityChoice = getValidatedIntInput("Enter City number: ");
-            if (cityChoice >= 1 && cityChoice <= (int)cities.size())
-            {
-                selectedCity = cities[cityChoice - 1];
-                cout << "-> Selected City: " << selectedCity << endl;
-                break;
-            }
-            cout << "Invalid city selection." << endl;
-        }
-
-        return selectedCity;
-    }
-
-    Theater *selectTheater(const string &city)
-    {
-        vector<Theater *> cityTheaters;
-        for (auto &theater : theaters)
-        {
-            if (theater.getCity() == city)
-            {
-                cityTheaters.push_back(&theater);
-            }
-        }
-
-        if (cityTheaters.empty())
-        {
-            cout << "No theaters available in " << city << "." << endl;
-            return nullptr;
-        }
-
-        printHeader("STEP 2.1: Select Theater");
-        cout << "Available theaters in " << city << ":" << endl;
-
-        for (size_t i = 0; i < cityTheaters.size(); ++i)
-        {
-            cout << "  [" << i + 1 << "] " << cityTheaters[i]->getName() << endl;
-        }
-
-        while (true)
-        {
-            int theaterChoice = getValidatedIntInput("Enter Theater number: ");
-            if (theaterChoice >= 1 && theaterChoice <= (int)cityTheaters.size())
-            {
-                Theater *selectedTheater = cityTheaters[theaterChoice - 1];
-                cout << "-> Selected Theater: " << selectedTheater->getName() << endl;
-                selectedTheater->displayLocationInfo(); // Using polymorphism
-                return selectedTheater;
-            }
-            cout << "Invalid theater number." << endl;
-        }
-    }
-
-    Showtime *selectShowtimeForTheater(Theater &theater)
-    {
-        string filterMovieTitle;
-        cout << "\nDo you want to filter showtimes by a movie title? (Y/N): ";
-        char filterChoice;
-        cin >> filterChoice;
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-
-        if (toupper(filterChoice) == 'Y')
-        {
-            cout << "Enter part of the movie title to filter (e.g., 'Architect'): ";
-            getline(cin, filterMovieTitle);
-            cout << "Filtering for movies containing: '" << filterMovieTitle << "'" << endl;
-        }
-
-        vector<Showtime *> theaterShowtimes;
-
-        for (auto &show : showtimes)
-        {
-            if (&show.getTheater() == &theater)
-            {
-                if (filterMovieTitle.empty() || show.getMovie().getTitle().find(filterMovieTitle) != string::npos)
-                {
-                    theaterShowtimes.push_back(&show);
-                }
-            }
-        }
-
-        if (theaterShowtimes.empty())
-        {
-            cout << "No showtimes available at " << theater.getName();
-            if (!filterMovieTitle.empty())
-            {
-                cout << " matching your filter.";
-            }
-            cout << endl;
-            return nullptr;
-        }
-
-        printHeader("STEP 2.2: Select Showtime (Time & Movie)");
-        cout << "Showtimes at " << theater.getName() << ":" << endl;
-
-        for (size_t i = 0; i < theaterShowtimes.size(); ++i)
-        {
-            theaterShowtimes[i]->displayDetails(i + 1);
-        }
-
-        while (true)
-        {
-            int showChoice = getValidatedIntInput("Enter Showtime number to book: ");
-            if (showChoice >= 1 && showChoice <= (int)theaterShowtimes.size())
-            {
-                Showtime *selectedShow = theaterShowtimes[showChoice - 1];
-                cout << "-> Confirmed: " << selectedShow->getMovie().getTitle()
-                     << " at " << selectedShow->getTime() << endl;
-                return selectedShow;
-            }
-            cout << "Invalid showtime number." << endl;
-        }
-    }
-
-    void cancelBooking()
-    {
-        printHeader("BOOKING CANCELLATION");
-        if (allBookings.empty())
-        {
-            cout << "There are no successful bookings to cancel." << endl;
-            return;
-        }
-
-        cout << "Existing Bookings:" << endl;
-        for (const auto &booking : allBookings)
-        {
-            booking.displayBriefDetails();
-        }
-        cout << LINE_SEPARATOR << endl;
-
-        int bookingIdToCancel = getValidatedIntInput("Enter the Reference ID of the booking to cancel (or 0 to abort): ");
-        if (bookingIdToCancel == 0)
-        {
-            cout << "Cancellation aborted." << endl;
-            return;
-        }
-
-        auto it = allBookings.begin();
-        while (it != allBookings.end())
-        {
-            if (it->getId() == bookingIdToCancel)
-            {
-                cout << "\n--- Confirmation ---" << endl;
-                cout << "Are you sure you want to cancel booking ID " << bookingIdToCancel << "? (Y/N): ";
-                char confirm;
-                cin >> confirm;
-                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                if (toupper(confirm) == 'Y')
-                {
-                    it->cancel();
-                    it = allBookings.erase(it);
-
-                    cout << "\n>> BOOKING ID " << bookingIdToCancel << " HAS BEEN SUCCESSFULLY CANCELED." << endl;
-                    cout << ">> Corresponding seats are now AVAILABLE." << endl;
-
-                    saveBookingData();
-                    return;
-                }
-                else
-                {
-                    cout << "Cancellation operation aborted by user." << endl;
-                    return;
-                }
-            }
-            ++it;
-        }
-
-        cout << "Error: Booking ID " << bookingIdToCancel << " not found." << endl;
-    }
-
-public:
-    SystemManager()
-    {
-        initializeData();
-    }
-
-    ~SystemManager()
-    {
-        saveBookingData();
-    }
-
-    void runBookingProcess()
-    {
-        while (true)
-        {
-            printHeader("MAIN MENU");
-            cout << "[1] Start New Booking" << endl;
-            cout << "[2] Cancel Existing Booking" << endl;
-            cout << "[3] Exit Application" << endl;
-            cout << LINE_SEPARATOR << endl;
-
-            int mainChoice = getValidatedIntInput("Enter your choice: ");
-
-            if (mainChoice == 3)
-            {
-                break;
-            }
-            else if (mainChoice == 2)
-            {
-                cancelBooking();
-                continue;
-            }
-            else if (mainChoice != 1)
-            {
-                cout << "Invalid choice. Please select 1, 2, or 3." << endl;
-                continue;
-            }
-
-            string selectedCity = selectLocation();
-
-            Theater *selectedTheaterPtr = selectTheater(selectedCity);
-
-            if (!selectedTheaterPtr)
-            {
-                cout << "\nBooking process aborted. No theater selected." << endl;
-                continue;
-            }
-
-            Showtime *selectedShowtimePtr = selectShowtimeForTheater(*selectedTheaterPtr);
-
-            if (!selectedShowtimePtr)
-            {
-                cout << "\nBooking process aborted. No showtime selected." << endl;
-                continue;
-            }
-
-            Showtime &selectedShowtime = *selectedShowtimePtr;
-            Theater &selectedTheater = selectedShowtime.getTheater();
-
-            vector<string> bookedSeatIds = selectSeats(selectedShowtime);
-
-            if (bookedSeatIds.empty())
-            {
-                cout << "\nBooking process aborted. No seats selected." << endl;
-                continue;
-            }
-
-            FoodOrder finalFoodOrder = selectFoodItems(selectedTheater);
-
-            Booking finalBooking(selectedShowtime, bookedSeatIds, finalFoodOrder);
-            finalBooking.generateBill();
-
-            allBookings.push_back(finalBooking);
-
-            saveBookingData();
-
-            cout << "\nPress Enter to return to the main menu...";
-            cin.get();
-        }
-    }
-};
-
-int main()
-{
-    cout << fixed << setprecision(2);
-
-    cout << LINE_SEPARATOR << endl;
-    cout << APP_NAME << " - C++ OOP Console Project" << endl;
-    cout << "Welcome to the world-class movie booking experience." << endl;
-    cout << "Demonstrating: Encapsulation, Inheritance, Polymorphism, Abstraction," << endl;
-    cout << "               Friend Functions, Friend Classes, Virtual Functions" << endl;
-    cout << LINE_SEPARATOR << endl;
-
-    SystemManager system;
-
-    system.runBookingProcess();
-
-    cout << "\n"
-         << LINE_SEPARATOR << endl;
-    cout << "Application Session Ended. All current bookings have been saved to " << BOOKING_DATA_FILE << endl;
-    cout << LINE_SEPARATOR << endl;
-
-    return 0;
-}
+#include <iostream>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <map>
+#include <array>
+#include <unordered_map>
+#include <stdexcept>
+#include <sstream>
+#include <limits>
+#include <fstream>
+#include <cstdlib>
+#include <charconv>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <memory_resource>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <cstdint>
+#include <utility>
+#include <bit>
+#include <string_view>
+#include <span>
+#include <cstdio>
+#include <filesystem>
+#include <cstring>
+#include <cmath>
+#include <random>
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <csignal>
+#include <cerrno>
+#endif
+using namespace std;
+
+// An amount in whole paise. Billing arithmetic stays in integers, so totals
+// and discounts are exact and formatting needs no stream.
+class Money
+{
+private:
+    int64_t paise;
+
+    constexpr explicit Money(int64_t p) : paise(p) {}
+
+public:
+    constexpr Money() : paise(0) {}
+
+    static constexpr Money fromPaise(int64_t p) { return Money(p); }
+    static constexpr Money fromRupees(int64_t rupees) { return Money(rupees * 100); }
+
+    constexpr int64_t getPaise() const { return paise; }
+
+    // The given whole percentage of the amount, rounded half away from zero.
+    constexpr Money percent(int64_t percentage) const
+    {
+        int64_t scaled = paise * percentage;
+        return Money((scaled + (scaled < 0 ? -50 : 50)) / 100);
+    }
+
+    // Even share over count parts, rounded half away from zero.
+    constexpr Money dividedBy(int64_t count) const
+    {
+        return Money((paise + (paise < 0 ? -count : count) / 2) / count);
+    }
+
+    constexpr Money operator+(Money other) const { return Money(paise + other.paise); }
+    constexpr Money operator-(Money other) const { return Money(paise - other.paise); }
+    constexpr Money operator*(int64_t quantity) const { return Money(paise * quantity); }
+    Money &operator+=(Money other)
+    {
+        paise += other.paise;
+        return *this;
+    }
+    constexpr auto operator<=>(const Money &) const = default;
+
+    // Writes "1234.50" into [first, last) and returns the end of the text;
+    // 24 characters always suffice.
+    char *format(char *first, char *last) const
+    {
+        uint64_t magnitude = (paise < 0 ? 0 - static_cast<uint64_t>(paise) : static_cast<uint64_t>(paise));
+        if (paise < 0)
+            *first++ = '-';
+        first = to_chars(first, last, magnitude / 100).ptr;
+        *first++ = '.';
+        *first++ = static_cast<char>('0' + magnitude % 100 / 10);
+        *first++ = static_cast<char>('0' + magnitude % 10);
+        return first;
+    }
+};
+
+const Money TICKET_PRICE_STANDARD = Money::fromRupees(250);
+const Money TICKET_PRICE_PREMIUM = Money::fromRupees(450);
+const Money FOOD_DISCOUNT_THRESHOLD = Money::fromRupees(500);
+const int FOOD_DISCOUNT_PERCENT = 10;
+const string APP_NAME = "CineSphere Booking Console";
+const string LINE_SEPARATOR = string(70, '-');
+const string BOOKING_DATA_FILE = "bookings.txt";
+const string BOOKING_JOURNAL_FILE = "bookings.journal";
+const string BOOKING_SNAPSHOT_FILE = "bookings.snap";
+const string PRICING_RULES_FILE = "pricing.rules";
+const string MOVIES_FILE = "movies.txt";
+const string THEATERS_FILE = "theaters.txt";
+const string MENUS_FILE = "menus.txt";
+const string SCHEDULE_FILE = "schedule.txt";
+const size_t CATALOG_CHUNK_BYTES = 256 * 1024;
+const size_t JOURNAL_QUEUE_CAPACITY = 4096;
+const size_t JOURNAL_SLOT_BYTES = 128;
+const size_t BOOKING_SHARDS = 16;
+const int FIRST_BOOKING_ID = 5001;
+const size_t JOURNAL_COMPACT_MIN_BYTES = 1024 * 1024;
+const int JOURNAL_COMPACT_PERCENT = 50;
+const int SEAT_HOLD_SECONDS = 600;
+const int HOLD_TICKS_PER_SECOND = 10;
+const int BEST_SEAT_ATTEMPTS = 8;
+const size_t TRANSACTION_ARENA_BYTES = 16 * 1024;
+const size_t SESSION_ARENA_BYTES = 4 * 1024;
+
+void printHeader(const string &title)
+{
+    cout << "\n"
+         << string(10, '=') << " " << title << " " << string(10, '=') << endl;
+}
+
+// Fixed-point text for plain quantities such as percentages and seconds;
+// amounts of money go through formatCurrency.
+string formatNumber(double value, int decimals = 2)
+{
+    char buffer[32];
+    auto result = to_chars(buffer, buffer + sizeof(buffer), value, chars_format::fixed, decimals);
+    return string(buffer, result.ec == errc() ? result.ptr : buffer);
+}
+
+// Short enough for the small-string buffer, so this does not allocate.
+string formatCurrency(Money amount)
+{
+    char buffer[24];
+    return string(buffer, amount.format(buffer, buffer + sizeof(buffer)));
+}
+
+bool parseWholeNumber(string_view text, int64_t &value)
+{
+    auto result = from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == errc() && result.ptr == text.data() + text.size();
+}
+
+// Rupees with up to two decimals, e.g. "120" or "99.50".
+bool parseRupees(string_view text, Money &amount)
+{
+    size_t dot = text.find('.');
+    int64_t rupees = 0, paise = 0;
+    if (!parseWholeNumber(text.substr(0, dot), rupees) || rupees < 0)
+        return false;
+    if (dot != string_view::npos)
+    {
+        string_view fraction = text.substr(dot + 1);
+        if (fraction.empty() || fraction.size() > 2 || !parseWholeNumber(fraction, paise))
+            return false;
+        paise *= (fraction.size() == 1 ? 10 : 1);
+    }
+    amount = Money::fromPaise(rupees * 100 + paise);
+    return true;
+}
+
+// "10:30 AM", "07:00 PM" or 24-hour "18:00" -> minutes after midnight.
+bool parseClockTime(string_view text, int &minutes)
+{
+    int64_t hours, mins;
+    size_t colon = text.find(':');
+    if (colon == string_view::npos || !parseWholeNumber(text.substr(0, colon), hours) ||
+        !parseWholeNumber(text.substr(colon + 1, 2), mins) || hours > 24 || mins > 59)
+    {
+        return false;
+    }
+    string_view suffix = text.substr(min(text.size(), colon + 3));
+    while (!suffix.empty() && suffix.front() == ' ')
+        suffix.remove_prefix(1);
+    if (suffix == "PM" && hours < 12)
+        hours += 12;
+    else if (suffix == "AM" && hours == 12)
+        hours = 0;
+    else if (!suffix.empty() && suffix != "AM" && suffix != "PM")
+        return false;
+    minutes = static_cast<int>(hours * 60 + mins);
+    return true;
+}
+
+// "YYYY-MM-DD" -> days since the epoch.
+bool parseCalendarDate(string_view text, chrono::sys_days &day)
+{
+    int64_t year, month, dayOfMonth;
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-' || !parseWholeNumber(text.substr(0, 4), year) ||
+        !parseWholeNumber(text.substr(5, 2), month) || !parseWholeNumber(text.substr(8, 2), dayOfMonth))
+    {
+        return false;
+    }
+    chrono::year_month_day ymd{chrono::year(static_cast<int>(year)), chrono::month(static_cast<unsigned>(month)),
+                               chrono::day(static_cast<unsigned>(dayOfMonth))};
+    if (!ymd.ok())
+        return false;
+    day = chrono::sys_days(ymd);
+    return true;
+}
+
+bool syncFile(FILE *file)
+{
+    if (fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Writes to a temporary file, syncs it, then renames it over the target so
+// readers only ever see the old or the new contents.
+bool writeFileAtomically(const string &path, const string &contents)
+{
+    string tempFile = path + ".tmp";
+    FILE *outFile = fopen(tempFile.c_str(), "wb");
+    if (!outFile)
+        return false;
+
+    bool written = fwrite(contents.data(), 1, contents.size(), outFile) == contents.size();
+    written = syncFile(outFile) && written;
+    fclose(outFile);
+
+    error_code ec;
+    if (written)
+    {
+        filesystem::rename(tempFile, path, ec);
+        if (!ec)
+            return true;
+    }
+    filesystem::remove(tempFile, ec);
+    return false;
+}
+
+// FNV-1a; stable across runs, so it can be written to disk.
+uint64_t hashKey(string_view key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (char ch : key)
+    {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Read-only view of a whole file. Memory-mapped on POSIX; read into a buffer elsewhere.
+class MappedFile
+{
+private:
+    const char *mappedData;
+    size_t mappedSize;
+    vector<char> buffer;
+
+public:
+    explicit MappedFile(const string &path) : mappedData(nullptr), mappedSize(0)
+    {
+#ifdef _WIN32
+        ifstream inFile(path, ios::binary);
+        if (inFile.is_open())
+        {
+            buffer.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+            mappedData = buffer.data();
+            mappedSize = buffer.size();
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED)
+            {
+                mappedData = static_cast<const char *>(mapped);
+                mappedSize = static_cast<size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (mappedData)
+            munmap(const_cast<char *>(mappedData), mappedSize);
+#endif
+    }
+
+    bool isOpen() const { return mappedData != nullptr; }
+    const char *data() const { return mappedData; }
+    size_t size() const { return mappedSize; }
+};
+
+// Global operator new is replaced so the benchmark can count the heap
+// allocations a booking transaction makes on its own thread.
+thread_local size_t threadHeapAllocations = 0;
+
+static void *allocateCounted(size_t size, size_t alignment)
+{
+    threadHeapAllocations++;
+    size = max<size_t>(size, 1);
+    alignment = max(alignment, sizeof(void *));
+    for (;;)
+    {
+#ifdef _WIN32
+        void *p = _aligned_malloc(size, alignment);
+#else
+        void *p = nullptr;
+        if (posix_memalign(&p, alignment, size) != 0)
+            p = nullptr;
+#endif
+        if (p)
+            return p;
+        new_handler handler = get_new_handler();
+        if (!handler)
+            throw bad_alloc();
+        handler();
+    }
+}
+
+static void releaseCounted(void *p)
+{
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+void *operator new(size_t size) { return allocateCounted(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new(size_t size, align_val_t alignment) { return allocateCounted(size, static_cast<size_t>(alignment)); }
+void operator delete(void *p) noexcept { releaseCounted(p); }
+void operator delete(void *p, size_t) noexcept { releaseCounted(p); }
+void operator delete(void *p, align_val_t) noexcept { releaseCounted(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { releaseCounted(p); }
+
+// Pass-through memory resource that counts the requests it forwards.
+class CountingResource : public pmr::memory_resource
+{
+private:
+    pmr::memory_resource *upstream;
+    size_t allocations;
+    size_t bytes;
+
+    void *do_allocate(size_t size, size_t alignment) override
+    {
+        allocations++;
+        bytes += size;
+        return upstream->allocate(size, alignment);
+    }
+
+    void do_deallocate(void *p, size_t size, size_t alignment) override
+    {
+        upstream->deallocate(p, size, alignment);
+    }
+
+    bool do_is_equal(const pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+public:
+    explicit CountingResource(pmr::memory_resource *u) : upstream(u), allocations(0), bytes(0) {}
+
+    size_t getAllocationCount() const { return allocations; }
+    size_t getAllocatedBytes() const { return bytes; }
+};
+
+// Scratch memory for one booking transaction. Allocations are bumped out of
+// a fixed buffer and all freed together by reset(); only a transaction that
+// outgrows the buffer reaches the global heap, which getHeapAllocationCount()
+// records. Not thread-safe: each session or worker owns its own arena.
+class TransactionArena
+{
+private:
+    unique_ptr<byte[]> buffer;
+    size_t capacity;
+    CountingResource heap;
+    pmr::monotonic_buffer_resource pool;
+    CountingResource served;
+
+public:
+    explicit TransactionArena(size_t bytes = TRANSACTION_ARENA_BYTES)
+        : buffer(make_unique<byte[]>(bytes)), capacity(bytes), heap(pmr::new_delete_resource()),
+          pool(buffer.get(), capacity, &heap), served(&pool) {}
+
+    TransactionArena(const TransactionArena &) = delete;
+    TransactionArena &operator=(const TransactionArena &) = delete;
+
+    pmr::memory_resource *resource() { return &served; }
+    void reset() { pool.release(); }
+
+    size_t getAllocationCount() const { return served.getAllocationCount(); }
+    size_t getHeapAllocationCount() const { return heap.getAllocationCount(); }
+};
+
+// Append-only sequence whose elements never move, so references and
+// pointers into it stay valid as it grows. Elements live in blocks that
+// double in size (64, 128, 256, ...) listed in a fixed table: growing
+// allocates one new block and copies nothing, and element i is located
+// with one bit scan. One thread may append while others read any element
+// below size().
+template <typename T>
+class StableVector
+{
+private:
+    static constexpr size_t FIRST_BLOCK_BITS = 6;
+    static constexpr size_t MAX_BLOCKS = 40;
+
+    T *blocks[MAX_BLOCKS] = {};
+    atomic<size_t> count{0};
+
+    static size_t blockOf(size_t index) { return bit_width((index >> FIRST_BLOCK_BITS) + 1) - 1; }
+    static size_t blockStart(size_t block) { return ((size_t(1) << block) - 1) << FIRST_BLOCK_BITS; }
+    static size_t blockSize(size_t block) { return size_t(1) << (block + FIRST_BLOCK_BITS); }
+
+public:
+    template <typename Element, typename Owner>
+    class Iterator
+    {
+    private:
+        Owner *owner;
+        size_t index;
+
+    public:
+        Iterator(Owner *o, size_t i) : owner(o), index(i) {}
+        Element &operator*() const { return (*owner)[index]; }
+        Element *operator->() const { return &(*owner)[index]; }
+        Iterator &operator++()
+        {
+            ++index;
+            return *this;
+        }
+        bool operator==(const Iterator &other) const { return index == other.index; }
+        bool operator!=(const Iterator &other) const { return index != other.index; }
+    };
+
+    StableVector() = default;
+    StableVector(const StableVector &) = delete;
+    StableVector &operator=(const StableVector &) = delete;
+
+    ~StableVector()
+    {
+        size_t total = count.load();
+        for (size_t i = 0; i < total; ++i)
+            (*this)[i].~T();
+        for (size_t block = 0; block < MAX_BLOCKS && blocks[block]; ++block)
+            ::operator delete(blocks[block], align_val_t(alignof(T)));
+    }
+
+    size_t size() const { return count.load(memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    T &operator[](size_t index)
+    {
+        size_t block = blockOf(index);
+        return blocks[block][index - blockStart(block)];
+    }
+
+    const T &operator[](size_t index) const
+    {
+        size_t block = blockOf(index);
+        return blocks[block][index - blockStart(block)];
+    }
+
+    T &front() { return (*this)[0]; }
+    T &back() { return (*this)[size() - 1]; }
+
+    // The element is constructed before it becomes visible to readers.
+    template <typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        size_t index = count.load(memory_order_relaxed);
+        size_t block = blockOf(index);
+        if (block >= MAX_BLOCKS)
+            throw length_error("StableVector is full");
+        if (!blocks[block])
+            blocks[block] = static_cast<T *>(::operator new(blockSize(block) * sizeof(T), align_val_t(alignof(T))));
+        T *element = new (blocks[block] + (index - blockStart(block))) T(std::forward<Args>(args)...);
+        count.store(index + 1, memory_order_release);
+        return *element;
+    }
+
+    Iterator<T, StableVector> begin() { return {this, 0}; }
+    Iterator<T, StableVector> end() { return {this, size()}; }
+    Iterator<const T, const StableVector> begin() const { return {this, 0}; }
+    Iterator<const T, const StableVector> end() const { return {this, size()}; }
+};
+
+// Cheap monotonic ticks for always-on timing: the time-stamp counter on
+// x86-64, steady_clock elsewhere. Converted to nanoseconds only when a
+// report is written, against the steady clock since process start.
+class TickClock
+{
+private:
+    uint64_t startTicks;
+    chrono::steady_clock::time_point startTime;
+
+    TickClock() : startTicks(now()), startTime(chrono::steady_clock::now()) {}
+
+public:
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    static const TickClock &instance()
+    {
+        static const TickClock clock;
+        return clock;
+    }
+
+    double nanosecondsPerTick() const
+    {
+        double ticks = static_cast<double>(now() - startTicks);
+        double nanoseconds = static_cast<double>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - startTime).count());
+        return (ticks > 0 && nanoseconds > 0) ? nanoseconds / ticks : 1.0;
+    }
+};
+
+// Takes the calibration baseline at startup.
+const TickClock &processTickClock = TickClock::instance();
+
+// Log-linear histogram of tick counts: 32 buckets per power of two, so a
+// reported percentile is within about 3% of the true value. Recording is
+// one relaxed atomic add per counter and safe from any thread.
+class LatencyHistogram
+{
+private:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    atomic<uint64_t> buckets[BUCKET_COUNT] = {};
+    atomic<uint64_t> count{0};
+    atomic<uint64_t> totalTicks{0};
+    atomic<uint64_t> maxTicks{0};
+
+    static int bucketOf(uint64_t ticks)
+    {
+        if (ticks < SUB_BUCKETS)
+            return static_cast<int>(ticks);
+        int magnitude = bit_width(ticks) - SUB_BUCKET_BITS;
+        return magnitude * SUB_BUCKETS + static_cast<int>((ticks >> (magnitude - 1)) - SUB_BUCKETS);
+    }
+
+    // Largest tick count that falls in bucket.
+    static uint64_t bucketLimit(int bucket)
+    {
+        int magnitude = bucket / SUB_BUCKETS;
+        uint64_t sub = bucket % SUB_BUCKETS;
+        if (magnitude == 0)
+            return sub;
+        return ((SUB_BUCKETS + sub + 1) << (magnitude - 1)) - 1;
+    }
+
+public:
+    void record(uint64_t ticks)
+    {
+        buckets[bucketOf(ticks)].fetch_add(1, memory_order_relaxed);
+        count.fetch_add(1, memory_order_relaxed);
+        totalTicks.fetch_add(ticks, memory_order_relaxed);
+        uint64_t seen = maxTicks.load(memory_order_relaxed);
+        while (ticks > seen && !maxTicks.compare_exchange_weak(seen, ticks, memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t getCount() const { return count.load(memory_order_relaxed); }
+    uint64_t getTotalTicks() const { return totalTicks.load(memory_order_relaxed); }
+    uint64_t getMaxTicks() const { return maxTicks.load(memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the p-quantile, capped at the maximum.
+    uint64_t percentileTicks(double p) const
+    {
+        uint64_t total = getCount();
+        if (total == 0)
+            return 0;
+        uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(p * static_cast<double>(total))));
+        uint64_t seen = 0;
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+        {
+            seen += buckets[bucket].load(memory_order_relaxed);
+            if (seen >= rank)
+                return min(bucketLimit(bucket), getMaxTicks());
+        }
+        return getMaxTicks();
+    }
+};
+
+enum class Stage
+{
+    CATALOG_LOAD,
+    BOOKINGS_LOAD,
+    SEAT_SELECTION,
+    SEAT_HOLD,
+    FOOD_ORDER,
+    BOOKING_CONFIRM,
+    BOOKING_CONSTRUCT,
+    GENERATE_BILL,
+    SAVE_BOOKINGS,
+    BOOKING_CANCEL,
+    COUNT
+};
+
+// Process-wide latency histograms, one per pipeline stage.
+class StageMetrics
+{
+private:
+    LatencyHistogram histograms[static_cast<int>(Stage::COUNT)];
+
+public:
+    static StageMetrics &instance()
+    {
+        static StageMetrics metrics;
+        return metrics;
+    }
+
+    static const char *stageName(Stage stage)
+    {
+        static const char *const names[] = {"catalog_load", "bookings_load", "seat_selection", "seat_hold",
+                                            "food_order", "booking_confirm", "booking_construct", "generate_bill",
+                                            "save_bookings", "booking_cancel"};
+        return names[static_cast<int>(stage)];
+    }
+
+    void record(Stage stage, uint64_t ticks) { histograms[static_cast<int>(stage)].record(ticks); }
+
+    // {"stage":{"count":..,"mean_ns":..,"p50_ns":..,"p99_ns":..,"p999_ns":..,"max_ns":..},...}
+    // Stages that never ran are left out.
+    void writeJson(ostream &out) const
+    {
+        double scale = TickClock::instance().nanosecondsPerTick();
+        auto nanoseconds = [scale](uint64_t ticks) { return static_cast<uint64_t>(ticks * scale); };
+        out << "{";
+        bool first = true;
+        for (int s = 0; s < static_cast<int>(Stage::COUNT); ++s)
+        {
+            const LatencyHistogram &histogram = histograms[s];
+            uint64_t count = histogram.getCount();
+            if (count == 0)
+                continue;
+            out << (first ? "" : ",") << "\"" << stageName(static_cast<Stage>(s)) << "\":{\"count\":" << count
+                << ",\"mean_ns\":" << nanoseconds(histogram.getTotalTicks() / count)
+                << ",\"p50_ns\":" << nanoseconds(histogram.percentileTicks(0.50))
+                << ",\"p99_ns\":" << nanoseconds(histogram.percentileTicks(0.99))
+                << ",\"p999_ns\":" << nanoseconds(histogram.percentileTicks(0.999))
+                << ",\"max_ns\":" << nanoseconds(histogram.getMaxTicks()) << "}";
+            first = false;
+        }
+        out << "}";
+    }
+};
+
+// Records the time from construction to destruction against a stage.
+class StageTimer
+{
+private:
+    Stage stage;
+    uint64_t start;
+
+public:
+    explicit StageTimer(Stage s) : stage(s), start(TickClock::now()) {}
+    ~StageTimer() { StageMetrics::instance().record(stage, TickClock::now() - start); }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+};
+
+void clearScreen()
+{
+#ifdef _WIN32
+    system("cls");
+#else
+    system("clear");
+#endif
+}
+
+
+class Product
+{
+protected:
+    string name;
+    Money price;
+
+public:
+    Product(string n, Money p) : name(n), price(p) {}
+
+    
+    virtual void displayInfo() const = 0;
+
+  
+    virtual ~Product() {}
+
+  
+    string getName() const { return name; }
+    Money getPrice() const { return price; }
+};
+
+
+class MenuItem : public Product
+{
+private:
+    string category;
+
+public:
+    MenuItem(string n, Money p, string c)
+        : Product(n, p), category(c) {}
+
+    string getCategory() const { return category; }
+
+
+    void displayInfo() const override
+    {
+        cout << "  " << left << setw(30) << name
+             << " - " << left << setw(10) << category
+             << " @ Rs " << formatCurrency(price) << endl;
+    }
+
+    void displayItem(int index) const
+    {
+        cout << "  [" << index << "] ";
+        displayInfo();
+    }
+};
+
+
+class Seat
+{
+public:
+    enum Status
+    {
+        AVAILABLE,
+        BOOKED,
+        SELECTED
+    };
+    enum Type
+    {
+        STANDARD,
+        PREMIUM
+    };
+
+private:
+    Status status;
+    Type type;
+
+public:
+    Seat(Type t, Status s = AVAILABLE) : status(s), type(t) {}
+
+    Status getStatus() const { return status; }
+    Type getType() const { return type; }
+    Money getPrice() const { return getPrice(type); }
+
+    // List price; theaters may override it in their own price table.
+    static Money getPrice(Type t) { return (t == PREMIUM ? TICKET_PRICE_PREMIUM : TICKET_PRICE_STANDARD); }
+
+    string getStatusString() const
+    {
+        if (status == BOOKED)
+            return "BOOKED";
+        if (status == SELECTED)
+            return "SELECTED";
+        return "AVAILABLE";
+    }
+
+    void displaySeat(const string &seatId) const
+    {
+        string displayChar = (type == PREMIUM ? "P" : "S");
+        if (status == BOOKED)
+        {
+            displayChar = "X";
+        }
+        else if (status == SELECTED)
+        {
+            displayChar = "V";
+        }
+        cout << "[" << displayChar << setw(4) << right << seatId << "]";
+    }
+};
+
+// Seat geometry shared by every show in a theater. Premium rows come first
+// (A, B, ...), then standard rows. Each row is padded to whole 64-bit words so
+// per-show inventories can scan a row without straddling its neighbours.
+class SeatLayout
+{
+private:
+    int premiumRows;
+    int rowCount;
+    int seatsPerRow;
+    int wordsPerRow;
+
+public:
+    SeatLayout(int stdRows, int premRows, int seatsPer)
+        : premiumRows(premRows), rowCount(stdRows + premRows), seatsPerRow(seatsPer),
+          wordsPerRow((seatsPer + 63) / 64)
+    {
+        if (stdRows < 0 || premRows < 0 || seatsPer <= 0 || rowCount > 26)
+        {
+            throw invalid_argument("Seat layout must have 1-26 rows and at least one seat per row");
+        }
+    }
+
+    int getRowCount() const { return rowCount; }
+    int getSeatsPerRow() const { return seatsPerRow; }
+    int getPremiumRows() const { return premiumRows; }
+    int getWordsPerRow() const { return wordsPerRow; }
+    int getCapacity() const { return rowCount * seatsPerRow; }
+    int getPremiumCapacity() const { return premiumRows * seatsPerRow; }
+
+    Seat::Type getRowType(int row) const { return (row < premiumRows ? Seat::PREMIUM : Seat::STANDARD); }
+    char getRowLetter(int row) const { return static_cast<char>('A' + row); }
+
+    string getSeatId(int row, int column) const
+    {
+        return string(1, getRowLetter(row)) + to_string(column + 1);
+    }
+
+    string getSeatId(int seatIndex) const { return getSeatId(seatIndex / seatsPerRow, seatIndex % seatsPerRow); }
+
+    int getSeatIndex(int row, int column) const { return row * seatsPerRow + column; }
+
+    bool getSeatPosition(int seatIndex, int &row, int &column) const
+    {
+        if (seatIndex < 0 || seatIndex >= getCapacity())
+            return false;
+        row = seatIndex / seatsPerRow;
+        column = seatIndex % seatsPerRow;
+        return true;
+    }
+
+    // Resolves an id such as "C10" arithmetically: the letter is the row and
+    // the number is the 1-based column. Ids with leading zeros are rejected.
+    bool findSeat(string_view seatId, int &row, int &column) const
+    {
+        if (seatId.size() < 2 || seatId.size() > 4 || seatId[1] == '0')
+            return false;
+
+        int r = seatId[0] - 'A';
+        if (r < 0 || r >= rowCount)
+            return false;
+
+        int c = 0;
+        for (size_t i = 1; i < seatId.size(); ++i)
+        {
+            if (seatId[i] < '0' || seatId[i] > '9')
+                return false;
+            c = c * 10 + (seatId[i] - '0');
+        }
+        if (c > seatsPerRow)
+            return false;
+
+        row = r;
+        column = c - 1;
+        return true;
+    }
+};
+
+class PriceCalculator;
+
+// Hold deadlines are counted in ticks since process start so that a deadline
+// and an owner token fit in one atomic word.
+uint32_t currentHoldTick()
+{
+    static const auto epoch = chrono::steady_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - epoch);
+    return static_cast<uint32_t>(elapsed.count() / (1000 / HOLD_TICKS_PER_SECOND));
+}
+
+// Booked/held state for one show, one bit per seat in each bitmap. The words
+// are atomic so concurrent sessions can hold and book seats without locks.
+// Every seat also has a hold tag naming its holder:
+//   bits 0-31 session token | bits 32-62 expiry tick | bit 63 busy
+// Tags only change by compare-and-swap. Whoever sets the busy bit owns the
+// seat's transition (confirm or release) until it stores 0 again, so the
+// held/booked bits can never be updated by two parties at once.
+class SeatInventory
+{
+private:
+    static constexpr uint64_t HOLD_BUSY = uint64_t(1) << 63;
+
+    const SeatLayout *layout;
+    size_t wordCount;
+    unique_ptr<atomic<uint64_t>[]> seatWords;  // booked words, then held words
+    atomic<uint64_t> *bookedBits;
+    atomic<uint64_t> *heldBits;
+    atomic<atomic<uint64_t> *> holdTags;        // one per seat, allocated by the first hold
+    unique_ptr<atomic<uint32_t>[]> rowWords;    // longest free run per row, then row versions
+    atomic<uint32_t> *rowLongestFree;
+    atomic<uint32_t> *rowVersions;
+    atomic<int> bookedByType[2];
+
+    size_t wordIndex(int row, int column) const
+    {
+        return static_cast<size_t>(row) * layout->getWordsPerRow() + column / 64;
+    }
+
+    static uint64_t bitMask(int column) { return uint64_t(1) << (column % 64); }
+
+    // Until the first hold every seat reads as unheld. Only a successful CAS
+    // on a real tag leads to a write, so the shared empty tag stays zero.
+    atomic<uint64_t> &holdTag(int row, int column) const
+    {
+        static atomic<uint64_t> noHold{0};
+        atomic<uint64_t> *tags = holdTags.load(memory_order_acquire);
+        return tags ? tags[layout->getSeatIndex(row, column)] : noHold;
+    }
+
+    // Most shows in a long schedule are never held, so they never pay for
+    // a tag per seat.
+    void allocateHoldTags()
+    {
+        atomic<uint64_t> *tags = holdTags.load(memory_order_acquire);
+        if (tags)
+            return;
+        auto fresh = make_unique<atomic<uint64_t>[]>(layout->getCapacity());
+        if (holdTags.compare_exchange_strong(tags, fresh.get(), memory_order_acq_rel))
+            fresh.release();
+    }
+
+    static uint64_t makeTag(uint32_t token, uint32_t expiryTick)
+    {
+        return (static_cast<uint64_t>(expiryTick & 0x7FFFFFFF) << 32) | token;
+    }
+
+    static uint32_t tagToken(uint64_t tag) { return static_cast<uint32_t>(tag); }
+    static uint32_t tagExpiry(uint64_t tag) { return static_cast<uint32_t>(tag >> 32) & 0x7FFFFFFF; }
+
+    static bool isExpired(uint64_t tag, uint32_t nowTick)
+    {
+        return tag != 0 && !(tag & HOLD_BUSY) && tagExpiry(tag) <= nowTick;
+    }
+
+    // Caller must have set the busy bit on the seat's tag.
+    void finishHold(int row, int column, bool book)
+    {
+        size_t w = wordIndex(row, column);
+        uint64_t mask = bitMask(column);
+        if (book && !(bookedBits[w].fetch_or(mask) & mask))
+        {
+            bookedByType[layout->getRowType(row)].fetch_add(1);
+        }
+        heldBits[w].fetch_and(~mask);
+        holdTag(row, column).store(0);
+        refreshRow(row);
+    }
+
+    // Calls visit(start, length) for every run of seats that are neither
+    // booked nor held, jumping whole runs at a time with bit scans.
+    template <typename Visitor>
+    void forEachFreeRun(int row, Visitor visit) const
+    {
+        size_t base = static_cast<size_t>(row) * layout->getWordsPerRow();
+        int seatsPerRow = layout->getSeatsPerRow();
+        int runStart = -1;
+        int c = 0;
+        while (c < seatsPerRow)
+        {
+            size_t w = base + c / 64;
+            int bit = c % 64;
+            int span = min(64 - bit, seatsPerRow - c);
+            uint64_t freeBits = ~(bookedBits[w].load() | heldBits[w].load()) >> bit;
+
+            int step = (runStart < 0 ? countr_zero(freeBits) : countr_one(freeBits));
+            if (step >= span)
+            {
+                c += span;
+                continue;
+            }
+            c += step;
+            if (runStart < 0)
+            {
+                runStart = c;
+            }
+            else
+            {
+                visit(runStart, c - runStart);
+                runStart = -1;
+            }
+        }
+        if (runStart >= 0)
+        {
+            visit(runStart, seatsPerRow - runStart);
+        }
+    }
+
+    // Keeps the per-row longest-free-run hint current. The version check
+    // repeats the scan if another update to the row raced with it.
+    void refreshRow(int row)
+    {
+        uint32_t version = rowVersions[row].fetch_add(1) + 1;
+        while (true)
+        {
+            int longest = 0;
+            auto measure = [&longest](int, int length)
+            {
+                longest = max(longest, length);
+            };
+            forEachFreeRun(row, measure);
+            rowLongestFree[row].store(static_cast<uint32_t>(longest));
+
+            uint32_t latest = rowVersions[row].load();
+            if (latest == version)
+                break;
+            version = latest;
+        }
+    }
+
+public:
+    explicit SeatInventory(const SeatLayout &l)
+        : layout(&l),
+          wordCount(static_cast<size_t>(l.getRowCount()) * l.getWordsPerRow()),
+          seatWords(make_unique<atomic<uint64_t>[]>(2 * wordCount)),
+          bookedBits(seatWords.get()),
+          heldBits(seatWords.get() + wordCount),
+          holdTags(nullptr),
+          rowWords(make_unique<atomic<uint32_t>[]>(2 * static_cast<size_t>(l.getRowCount()))),
+          rowLongestFree(rowWords.get()),
+          rowVersions(rowWords.get() + l.getRowCount()),
+          bookedByType{0, 0}
+    {
+        for (int row = 0; row < l.getRowCount(); ++row)
+        {
+            rowLongestFree[row].store(static_cast<uint32_t>(l.getSeatsPerRow()));
+        }
+    }
+
+    ~SeatInventory() { delete[] holdTags.load(); }
+
+    SeatInventory(const SeatInventory &) = delete;
+    SeatInventory &operator=(const SeatInventory &) = delete;
+
+    const SeatLayout &getLayout() const { return *layout; }
+
+    Seat::Status getStatus(int row, int column) const
+    {
+        size_t w = wordIndex(row, column);
+        uint64_t mask = bitMask(column);
+        if (bookedBits[w].load() & mask)
+            return Seat::BOOKED;
+        if (heldBits[w].load() & mask)
+            return Seat::SELECTED;
+        return Seat::AVAILABLE;
+    }
+
+    Seat getSeat(int row, int column) const
+    {
+        return Seat(layout->getRowType(row), getStatus(row, column));
+    }
+
+    bool isHeldBy(int row, int column, uint32_t token) const
+    {
+        uint64_t tag = holdTag(row, column).load();
+        return tag != 0 && tagToken(tag) == token;
+    }
+
+    // Holds a free seat for token until expiryTick. A hold whose deadline
+    // has passed is reclaimed first. The first successful CAS wins the seat.
+    bool tryHold(int row, int column, uint32_t token, uint32_t expiryTick, uint32_t nowTick)
+    {
+        allocateHoldTags();
+        atomic<uint64_t> &tag = holdTag(row, column);
+        uint64_t current = tag.load();
+        while (true)
+        {
+            if (current != 0)
+            {
+                if (!isExpired(current, nowTick))
+                    return false;
+                if (tag.compare_exchange_weak(current, current | HOLD_BUSY))
+                {
+                    finishHold(row, column, false);
+                    current = 0;
+                }
+                continue;
+            }
+            if (tag.compare_exchange_weak(current, makeTag(token, expiryTick)))
+                break;
+        }
+
+        size_t w = wordIndex(row, column);
+        uint64_t mask = bitMask(column);
+        if (bookedBits[w].load() & mask)
+        {
+            tag.store(0);
+            return false;
+        }
+        heldBits[w].fetch_or(mask);
+        refreshRow(row);
+        return true;
+    }
+
+    bool releaseHold(int row, int column, uint32_t token)
+    {
+        atomic<uint64_t> &tag = holdTag(row, column);
+        uint64_t current = tag.load();
+        while (current != 0 && !(current & HOLD_BUSY) && tagToken(current) == token)
+        {
+            if (tag.compare_exchange_weak(current, current | HOLD_BUSY))
+            {
+                finishHold(row, column, false);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Reclaims token's hold once its deadline has passed. A no-op if the seat
+    // was since released, confirmed or re-held with a later deadline.
+    bool expireHold(int row, int column, uint32_t token, uint32_t nowTick)
+    {
+        atomic<uint64_t> &tag = holdTag(row, column);
+        uint64_t current = tag.load();
+        while (isExpired(current, nowTick) && tagToken(current) == token)
+        {
+            if (tag.compare_exchange_weak(current, current | HOLD_BUSY))
+            {
+                finishHold(row, column, false);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // First phase of a confirm: pins token's live hold so it can neither
+    // expire nor be released. pinnedTag receives the tag for unpinHold.
+    bool pinHold(int row, int column, uint32_t token, uint32_t nowTick, uint64_t &pinnedTag)
+    {
+        atomic<uint64_t> &tag = holdTag(row, column);
+        uint64_t current = tag.load();
+        while (current != 0 && !(current & HOLD_BUSY) && tagToken(current) == token && tagExpiry(current) > nowTick)
+        {
+            if (tag.compare_exchange_weak(current, current | HOLD_BUSY))
+            {
+                pinnedTag = current;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void unpinHold(int row, int column, uint64_t pinnedTag)
+    {
+        holdTag(row, column).store(pinnedTag);
+    }
+
+    void bookPinnedHold(int row, int column)
+    {
+        finishHold(row, column, true);
+    }
+
+    // Direct booking, used while restoring saved state before any session runs.
+    bool book(int row, int column)
+    {
+        uint64_t mask = bitMask(column);
+        bool changed = !(bookedBits[wordIndex(row, column)].fetch_or(mask) & mask);
+        if (changed)
+        {
+            bookedByType[layout->getRowType(row)].fetch_add(1);
+            refreshRow(row);
+        }
+        return changed;
+    }
+
+    bool release(int row, int column)
+    {
+        uint64_t mask = bitMask(column);
+        bool changed = (bookedBits[wordIndex(row, column)].fetch_and(~mask) & mask) != 0;
+        if (changed)
+        {
+            bookedByType[layout->getRowType(row)].fetch_sub(1);
+            refreshRow(row);
+        }
+        return changed;
+    }
+
+    int getLongestFreeRun(int row) const { return static_cast<int>(rowLongestFree[row].load()); }
+
+    // Finds the most central block of count adjacent free seats in rows of
+    // the given type. Rows whose longest free run is too short are skipped
+    // without touching their words. Cost is measured in half-seat offsets of
+    // the block centre from the row centre, plus the same for the row from
+    // the middle row of the section.
+    bool findBestBlock(int count, Seat::Type type, int &bestRow, int &bestColumn) const
+    {
+        int seatsPerRow = layout->getSeatsPerRow();
+        int firstRow = (type == Seat::PREMIUM ? 0 : layout->getPremiumRows());
+        int lastRow = (type == Seat::PREMIUM ? layout->getPremiumRows() : layout->getRowCount());
+        if (count <= 0 || count > seatsPerRow || firstRow >= lastRow)
+            return false;
+
+        int idealStart = (seatsPerRow - count) / 2;
+        int bestCost = numeric_limits<int>::max();
+        for (int row = firstRow; row < lastRow; ++row)
+        {
+            if (getLongestFreeRun(row) < count)
+                continue;
+
+            int rowCost = abs(2 * row - (firstRow + lastRow - 1));
+            auto consider = [&](int start, int length)
+            {
+                if (length < count)
+                    return;
+                int column = clamp(idealStart, start, start + length - count);
+                int cost = rowCost + abs(2 * column + count - seatsPerRow);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestRow = row;
+                    bestColumn = column;
+                }
+            };
+            forEachFreeRun(row, consider);
+        }
+        return bestCost != numeric_limits<int>::max();
+    }
+
+    size_t getWordCount() const { return wordCount; }
+    uint64_t getBookedWord(size_t index) const { return bookedBits[index].load(); }
+
+    // Replaces the booked bitmap wholesale, e.g. from a snapshot; holds are dropped.
+    bool loadBookedWords(const void *words, size_t count)
+    {
+        if (count != wordCount)
+            return false;
+        const char *bytes = static_cast<const char *>(words);
+        size_t premiumWords = static_cast<size_t>(layout->getPremiumRows()) * layout->getWordsPerRow();
+        int premium = 0, standard = 0;
+        for (size_t w = 0; w < wordCount; ++w)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + w * sizeof(uint64_t), sizeof(word));
+            bookedBits[w].store(word);
+            heldBits[w].store(0);
+            (w < premiumWords ? premium : standard) += popcount(word);
+        }
+        bookedByType[Seat::PREMIUM].store(premium);
+        bookedByType[Seat::STANDARD].store(standard);
+        atomic<uint64_t> *tags = holdTags.load();
+        for (int seat = 0; tags && seat < layout->getCapacity(); ++seat)
+        {
+            tags[seat].store(0);
+        }
+        for (int row = 0; row < layout->getRowCount(); ++row)
+        {
+            refreshRow(row);
+        }
+        return true;
+    }
+
+    // Booked-seat counts are kept per seat class as bits flip, so reads are O(1).
+    int countBooked() const
+    {
+        return bookedByType[Seat::PREMIUM].load() + bookedByType[Seat::STANDARD].load();
+    }
+
+    int countBooked(Seat::Type type) const
+    {
+        return bookedByType[type].load();
+    }
+
+    void displayRow(int row) const
+    {
+        Seat::Type type = layout->getRowType(row);
+        int seatsPerRow = layout->getSeatsPerRow();
+        for (int w = 0; w < layout->getWordsPerRow(); ++w)
+        {
+            size_t idx = static_cast<size_t>(row) * layout->getWordsPerRow() + w;
+            uint64_t booked = bookedBits[idx].load();
+            uint64_t held = heldBits[idx].load();
+            int first = w * 64;
+            int last = min(first + 64, seatsPerRow);
+            for (int c = first; c < last; ++c)
+            {
+                uint64_t mask = uint64_t(1) << (c - first);
+                Seat::Status status = (booked & mask) ? Seat::BOOKED : ((held & mask) ? Seat::SELECTED : Seat::AVAILABLE);
+                Seat(type, status).displaySeat(layout->getSeatId(row, c));
+            }
+        }
+    }
+
+    friend class PriceCalculator;
+};
+
+
+class Entertainment
+{
+protected:
+    string title;
+    string genre;
+    int durationMinutes;
+
+public:
+    Entertainment(string t, string g, int d)
+        : title(t), genre(g), durationMinutes(d) {}
+
+    virtual ~Entertainment() {}
+
+   
+    virtual void displayDetails(int index) const
+    {
+        cout << "  [" << index << "] " << left << setw(40) << title
+             << " (" << genre << ", " << durationMinutes << " mins)" << endl;
+    }
+
+    const string &getTitle() const { return title; }
+    int getDuration() const { return durationMinutes; }
+    const string &getGenre() const { return genre; }
+};
+
+
+using MovieId = uint32_t;
+
+class Movie : public Entertainment
+{
+private:
+    MovieId movieId;
+    string director;
+    string language;
+
+public:
+    Movie(MovieId id, string t, string g, int d, string dir = "Unknown", string lang = "English")
+        : Entertainment(t, g, d), movieId(id), director(dir), language(lang) {}
+
+   
+    void displayDetails(int index) const override
+    {
+        cout << "  [" << index << "] " << left << setw(40) << title
+             << " (" << genre << ", " << durationMinutes << " mins, " << language << ")" << endl;
+    }
+
+    MovieId getId() const { return movieId; }
+    const string &getDirector() const { return director; }
+    const string &getLanguage() const { return language; }
+};
+
+
+class FoodOrder
+{
+private:
+    pmr::map<pmr::string, pair<int, Money>> orderItems;
+    Money totalFoodPrice;
+
+public:
+    explicit FoodOrder(pmr::memory_resource *resource = pmr::get_default_resource())
+        : orderItems(resource) {}
+
+    FoodOrder(const FoodOrder &other, pmr::memory_resource *resource)
+        : orderItems(other.orderItems, resource), totalFoodPrice(other.totalFoodPrice) {}
+
+    FoodOrder(const FoodOrder &) = default;
+    FoodOrder(FoodOrder &&) = default;
+    FoodOrder &operator=(const FoodOrder &) = default;
+    FoodOrder &operator=(FoodOrder &&) = default;
+
+    void addItem(const MenuItem &item, int quantity)
+    {
+        if (quantity <= 0)
+            return;
+
+        pmr::string name(item.getName(), orderItems.get_allocator());
+        auto it = orderItems.find(name);
+        if (it != orderItems.end())
+        {
+            it->second.first += quantity;
+        }
+        else
+        {
+            orderItems.emplace(move(name), make_pair(quantity, item.getPrice()));
+        }
+        totalFoodPrice += item.getPrice() * quantity;
+    }
+
+    Money getTotalPrice() const
+    {
+        return totalFoodPrice;
+    }
+
+    bool isEmpty() const
+    {
+        return orderItems.empty();
+    }
+
+    template <typename Visitor>
+    void forEachItem(Visitor visit) const
+    {
+        for (const auto &entry : orderItems)
+        {
+            visit(string_view(entry.first), entry.second.first);
+        }
+    }
+
+    void displayOrder() const
+    {
+        cout << "\n    --- Food Order Details ---" << endl;
+        if (isEmpty())
+        {
+            cout << "    (No food items ordered)" << endl;
+            return;
+        }
+        for (const auto &entry : orderItems)
+        {
+            const pmr::string &name = entry.first;
+            int quantity = entry.second.first;
+            Money pricePerItem = entry.second.second;
+            Money subtotal = pricePerItem * quantity;
+
+            cout << "    * " << left << setw(30) << name
+                 << " x" << setw(3) << right << quantity
+                 << " @ Rs " << formatCurrency(pricePerItem)
+                 << " = Rs " << formatCurrency(subtotal) << endl;
+        }
+        cout << "    Total Food Cost: Rs " << formatCurrency(totalFoodPrice) << endl;
+    }
+
+    friend class PriceCalculator;
+    friend Money calculateDiscount(const FoodOrder &order, int discountPercent);
+};
+
+
+Money calculateDiscount(const FoodOrder &order, int discountPercent)
+{
+
+    return order.totalFoodPrice.percent(discountPercent);
+}
+
+
+class Location
+{
+protected:
+    string name;
+    string city;
+    string state;
+
+public:
+    Location(string n, string c, string s) : name(n), city(c), state(s) {}
+
+    virtual ~Location() {}
+
+   
+    virtual void displayLocationInfo() const = 0;
+
+    const string &getName() const { return name; }
+    const string &getCity() const { return city; }
+    const string &getState() const { return state; }
+};
+
+
+// Running booking aggregates, adjusted as bookings are made and cancelled so
+// occupancy and revenue can be read without scanning seats or bookings.
+// Copying takes a point-in-time snapshot, which keeps the owners movable.
+struct BookingCounters
+{
+    atomic<int> bookings{0};
+    atomic<int> premiumSeats{0};
+    atomic<int> standardSeats{0};
+    atomic<int64_t> ticketRevenuePaise{0};
+    atomic<int64_t> foodRevenuePaise{0};
+    atomic<int64_t> discountPaise{0};
+
+    BookingCounters() = default;
+
+    BookingCounters(const BookingCounters &other)
+        : bookings(other.bookings.load()), premiumSeats(other.premiumSeats.load()),
+          standardSeats(other.standardSeats.load()), ticketRevenuePaise(other.ticketRevenuePaise.load()),
+          foodRevenuePaise(other.foodRevenuePaise.load()), discountPaise(other.discountPaise.load()) {}
+
+    BookingCounters &operator=(const BookingCounters &) = delete;
+
+    // sign is +1 when a booking is added and -1 when it is cancelled.
+    void apply(int sign, int premium, int standard, Money tickets, Money food, Money discount)
+    {
+        add(sign, sign * premium, sign * standard, tickets * sign, food * sign, discount * sign);
+    }
+
+    // Adds the summed totals of count bookings, e.g. all those restored for a show.
+    void add(int count, int premium, int standard, Money tickets, Money food, Money discount)
+    {
+        bookings.fetch_add(count);
+        premiumSeats.fetch_add(premium);
+        standardSeats.fetch_add(standard);
+        ticketRevenuePaise.fetch_add(tickets.getPaise());
+        foodRevenuePaise.fetch_add(food.getPaise());
+        discountPaise.fetch_add(discount.getPaise());
+    }
+
+    int bookedSeats() const { return premiumSeats.load() + standardSeats.load(); }
+    Money ticketRevenue() const { return Money::fromPaise(ticketRevenuePaise.load()); }
+    Money foodRevenue() const { return Money::fromPaise(foodRevenuePaise.load()); }
+    Money discounts() const { return Money::fromPaise(discountPaise.load()); }
+    Money netRevenue() const { return ticketRevenue() + foodRevenue() - discounts(); }
+};
+
+using TheaterId = uint32_t;
+
+class Theater : public Location
+{
+private:
+    TheaterId theaterId;
+    vector<MenuItem> menu;
+    SeatLayout layout;
+    BookingCounters counters;
+    int showtimeCount;
+    Money ticketPrices[2];
+
+    void initializeMenu()
+    {
+        menu.emplace_back("Caramel Popcorn (Large)", Money::fromRupees(350), "Popcorn");
+        menu.emplace_back("Salty Popcorn (Medium)", Money::fromRupees(250), "Popcorn");
+        menu.emplace_back("Coca-Cola (500ml)", Money::fromRupees(150), "Beverage");
+        menu.emplace_back("Fresh Lime Soda", Money::fromRupees(180), "Beverage");
+        menu.emplace_back("Nachos with Cheese Dip", Money::fromRupees(290), "Snack");
+        menu.emplace_back("Veg Burger", Money::fromRupees(220), "Snack");
+    }
+
+public:
+    Theater(TheaterId id, string n, string c, string s, int stdRows, int premRows, int seatsPer)
+        : Location(n, c, s), theaterId(id), layout(stdRows, premRows, seatsPer), showtimeCount(0),
+          ticketPrices{Seat::getPrice(Seat::STANDARD), Seat::getPrice(Seat::PREMIUM)}
+    {
+        initializeMenu();
+    }
+
+  
+    void displayLocationInfo() const override
+    {
+        cout << "Theater: " << name << " | City: " << city
+             << " | State: " << state << " | Capacity: " << layout.getCapacity() << " seats" << endl;
+    }
+
+    TheaterId getId() const { return theaterId; }
+    const vector<MenuItem> &getMenu() const { return menu; }
+    const SeatLayout &getSeatLayout() const { return layout; }
+    int getCapacity() const { return layout.getCapacity(); }
+    BookingCounters &getCounters() { return counters; }
+    const BookingCounters &getCounters() const { return counters; }
+    int getShowtimeCount() const { return showtimeCount; }
+    void addShowtimeSlot() { showtimeCount++; }
+    Money getTicketPrice(Seat::Type type) const { return ticketPrices[type]; }
+
+    // Applies to showtimes added after the change.
+    void setTicketPrice(Seat::Type type, Money price) { ticketPrices[type] = price; }
+
+    // Replaces the default menu. Bookings store food by menu position, so
+    // set it before any are made.
+    void setMenu(vector<MenuItem> items) { menu = move(items); }
+
+    void displayDetails(int index) const
+    {
+        cout << "  [" << index << "] " << name << ", " << city << endl;
+    }
+};
+
+using ShowtimeId = uint32_t;
+
+// One pricing rule. Conditions left at their defaults match everything.
+// Seat effects rewrite each seat's price in rule order; order effects are
+// summed into the booking's discount.
+struct PricingRule
+{
+    enum Effect
+    {
+        SEAT_PERCENT,
+        SEAT_AMOUNT,
+        SEAT_PRICE,
+        TICKETS_PERCENT_OFF,
+        FOOD_PERCENT_OFF,
+        ORDER_AMOUNT_OFF
+    };
+
+    string name;
+    uint8_t dayMask = 0x7F; // bit n is weekday n, Sunday = 0
+    int fromMinute = 0;     // show start window, minutes after midnight
+    int toMinute = 24 * 60;
+    int seatClassMask = 3;  // bit per Seat::Type
+    int firstRow = 0;
+    int lastRow = 25;
+    int minOccupancy = 0;   // percent of the show booked before this booking
+    string promoCode;
+    int minSeats = 0;
+    bool hasMinFood = false;
+    Money minFood;          // food total must exceed this when hasMinFood
+    Effect effect = SEAT_PERCENT;
+    int64_t value = 0;      // percent, or paise for the amount effects
+
+    bool isSeatRule() const { return effect <= SEAT_PRICE; }
+};
+
+// The rules that can apply to one showtime, flattened: one price per seat
+// row for each occupancy band, plus the order-level rules. Immutable once
+// built, so booking threads read it without locks.
+class ShowPricing
+{
+private:
+    int rowCount;
+    vector<int> occupancyBreaks;
+    vector<Money> rowPrices;
+    vector<PricingRule> orderRules;
+
+    friend class PricingEngine;
+
+public:
+    explicit ShowPricing(int rows) : rowCount(rows) {}
+
+    Money getSeatPrice(int row, int occupancyPercent) const
+    {
+        size_t band = upper_bound(occupancyBreaks.begin(), occupancyBreaks.end(), occupancyPercent) - occupancyBreaks.begin();
+        return rowPrices[band * rowCount + row];
+    }
+
+    // Calls visit(rule) for each order rule a customer earns by spending
+    // enough on food, leaving out promo-code rules.
+    template <typename Visitor>
+    void forEachFoodOffer(Visitor visit) const
+    {
+        for (const PricingRule &rule : orderRules)
+        {
+            if (rule.hasMinFood && rule.promoCode.empty())
+                visit(rule);
+        }
+    }
+
+    // Sum of the order rules that apply, capped at the order total; the
+    // applied rule names are joined into label.
+    Money getOrderDiscount(int seatCount, Money tickets, const FoodOrder &order, string_view promoCode, pmr::string &label) const
+    {
+        Money food = order.getTotalPrice();
+        Money discount;
+        label.clear();
+        for (const PricingRule &rule : orderRules)
+        {
+            if ((!rule.promoCode.empty() && rule.promoCode != promoCode) || seatCount < rule.minSeats ||
+                (rule.hasMinFood && !(food > rule.minFood)))
+            {
+                continue;
+            }
+            if (rule.effect == PricingRule::TICKETS_PERCENT_OFF)
+                discount += tickets.percent(rule.value);
+            else if (rule.effect == PricingRule::FOOD_PERCENT_OFF)
+                discount += calculateDiscount(order, static_cast<int>(rule.value));
+            else
+                discount += Money::fromPaise(rule.value);
+            if (!label.empty())
+                label += ", ";
+            label += rule.name;
+        }
+        return min(discount, tickets + food);
+    }
+};
+
+class Showtime
+{
+private:
+    ShowtimeId showtimeId;
+    const Movie &movie;
+    Theater &theater;
+    string time;
+    string date;
+    string uniqueShowId;
+    SeatInventory seats;
+    BookingCounters counters;
+    mutable const ShowPricing *pricing;
+
+    string createUniqueId() const
+    {
+        string id;
+        id.reserve(theater.getName().size() + date.size() + time.size() + movie.getTitle().size() + 3);
+        id.append(theater.getName()).append("|").append(date).append("|").append(time).append("|").append(movie.getTitle());
+        return id;
+    }
+
+public:
+    Showtime(ShowtimeId id, const Movie &m, Theater &t, string tm, string d)
+        : showtimeId(id), movie(m), theater(t), time(tm), date(d), seats(t.getSeatLayout()), pricing(nullptr)
+    {
+        uniqueShowId = createUniqueId();
+    }
+
+    ShowtimeId getId() const { return showtimeId; }
+    const Movie &getMovie() const { return movie; }
+    Theater &getTheater() const { return theater; }
+    string getTime() const { return time; }
+    string getDate() const { return date; }
+    const string &getUniqueShowId() const { return uniqueShowId; }
+    SeatInventory &getSeatInventory() { return seats; }
+    const SeatInventory &getSeatInventory() const { return seats; }
+    BookingCounters &getCounters() { return counters; }
+    const BookingCounters &getCounters() const { return counters; }
+
+    // Swapped by the engine when the rules change; readers see the old or
+    // the new table, both of which stay alive.
+    const ShowPricing &getPricing() const { return *atomic_ref(pricing).load(memory_order_acquire); }
+    void setPricing(const ShowPricing *compiled) { atomic_ref(pricing).store(compiled, memory_order_release); }
+
+    int getOccupancyPercent() const
+    {
+        return seats.countBooked() * 100 / max(1, theater.getCapacity());
+    }
+
+    // Current price of the first row of the given class.
+    Money getSeatPrice(Seat::Type type) const
+    {
+        const SeatLayout &layout = theater.getSeatLayout();
+        int row = (type == Seat::PREMIUM ? 0 : layout.getPremiumRows());
+        return getPricing().getSeatPrice(min(row, layout.getRowCount() - 1), getOccupancyPercent());
+    }
+
+    void displayDetails(int index) const
+    {
+        cout << "  [" << index << "] ";
+        cout << left << setw(10) << time;
+        cout << " - " << left << setw(30) << movie.getTitle();
+        cout << " (" << movie.getDuration() << " mins) on " << date << endl;
+    }
+};
+
+
+// Holds the active pricing rules and compiles them per showtime. Compiled
+// tables are never freed while the engine lives, because a booking thread
+// may still be reading the table a showtime pointed at before a reprice.
+class PricingEngine
+{
+private:
+    vector<PricingRule> rules;
+    vector<unique_ptr<ShowPricing>> compiled;
+    // Showtimes on the same weekday and start time in theaters with the same
+    // row layout and base prices share one table. Cleared when the rules change.
+    struct TableKey
+    {
+        uint64_t slot; // row count, premium rows, weekday and start minute
+        int64_t standardPaise;
+        int64_t premiumPaise;
+
+        bool operator==(const TableKey &) const = default;
+    };
+    struct TableKeyHash
+    {
+        size_t operator()(const TableKey &key) const
+        {
+            return static_cast<size_t>((key.slot * 0x9E3779B97F4A7C15ULL) ^ (key.standardPaise * 31 + key.premiumPaise));
+        }
+    };
+    unordered_map<TableKey, const ShowPricing *, TableKeyHash> compiledByKey;
+    mutex compileMutex;
+
+    // "+20%", "-15%", "+50", "300" -> signed percent or paise.
+    static bool parseAdjustment(string_view text, bool &isPercent, int64_t &value)
+    {
+        int sign = 1;
+        if (!text.empty() && (text[0] == '+' || text[0] == '-'))
+        {
+            sign = (text[0] == '-' ? -1 : 1);
+            text.remove_prefix(1);
+        }
+        isPercent = (!text.empty() && text.back() == '%');
+        if (isPercent)
+        {
+            text.remove_suffix(1);
+            if (!parseWholeNumber(text, value))
+                return false;
+            value *= sign;
+            return true;
+        }
+        Money amount;
+        if (!parseRupees(text, amount))
+            return false;
+        value = sign * amount.getPaise();
+        return true;
+    }
+
+    // Weekday (Sunday = 0) of a "YYYY-MM-DD" date, or -1.
+    static int weekdayOf(const string &date)
+    {
+        chrono::sys_days day;
+        return parseCalendarDate(date, day) ? static_cast<int>(chrono::weekday(day).c_encoding()) : -1;
+    }
+
+    static bool appliesToShow(const PricingRule &rule, int weekday, int startMinute)
+    {
+        if (weekday >= 0 && !(rule.dayMask & (1 << weekday)))
+            return false;
+        return startMinute < 0 || (startMinute >= rule.fromMinute && startMinute < rule.toMinute);
+    }
+
+    static Money applySeatRule(const PricingRule &rule, Money price)
+    {
+        if (rule.effect == PricingRule::SEAT_PRICE)
+            return Money::fromPaise(rule.value);
+        Money adjusted = price + (rule.effect == PricingRule::SEAT_PERCENT ? price.percent(rule.value) : Money::fromPaise(rule.value));
+        return max(adjusted, Money());
+    }
+
+public:
+    PricingEngine()
+    {
+        PricingRule foodDiscount;
+        foodDiscount.name = to_string(FOOD_DISCOUNT_PERCENT) + "% on Food";
+        foodDiscount.hasMinFood = true;
+        foodDiscount.minFood = FOOD_DISCOUNT_THRESHOLD;
+        foodDiscount.effect = PricingRule::FOOD_PERCENT_OFF;
+        foodDiscount.value = FOOD_DISCOUNT_PERCENT;
+        rules.push_back(foodDiscount);
+    }
+
+    const vector<PricingRule> &getRules() const { return rules; }
+    void setRules(vector<PricingRule> newRules)
+    {
+        lock_guard<mutex> lock(compileMutex);
+        rules = move(newRules);
+        compiledByKey.clear();
+    }
+
+    // Parses "<name> key=value ...". Conditions: days=MON,TUE,...
+    // from=HH:MM to=HH:MM class=P|S rows=A-C occupancy=<percent>
+    // promo=<code> seats=<min seats> food=<food total above, Rs>.
+    // Exactly one effect: seat=+20% | seat=-50 | price=300 (per seat), or
+    // tickets=-10% | foodoff=-10% | order=-100 (per booking).
+    static bool parseRule(string_view line, PricingRule &rule, string &error)
+    {
+        static const string_view dayNames[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+        rule = PricingRule();
+        bool hasEffect = false;
+        size_t pos = 0;
+        while (pos < line.size())
+        {
+            size_t tokenEnd = min(line.find(' ', pos), line.size());
+            string_view token = line.substr(pos, tokenEnd - pos);
+            pos = tokenEnd + 1;
+            if (token.empty())
+                continue;
+            if (rule.name.empty())
+            {
+                rule.name = string(token);
+                continue;
+            }
+
+            size_t equals = token.find('=');
+            string_view key = token.substr(0, equals);
+            string_view value = (equals == string_view::npos ? string_view() : token.substr(equals + 1));
+            int64_t number = 0;
+            bool isPercent = false;
+            bool ok = true;
+            if (value.empty())
+                ok = false;
+            else if (key == "days")
+            {
+                rule.dayMask = 0;
+                for (size_t start = 0; ok && start < value.size();)
+                {
+                    size_t comma = min(value.find(',', start), value.size());
+                    auto day = find(begin(dayNames), end(dayNames), value.substr(start, comma - start));
+                    ok = (day != end(dayNames));
+                    rule.dayMask |= static_cast<uint8_t>(ok ? 1 << (day - begin(dayNames)) : 0);
+                    start = comma + 1;
+                }
+            }
+            else if (key == "from")
+                ok = parseClockTime(value, rule.fromMinute);
+            else if (key == "to")
+                ok = parseClockTime(value, rule.toMinute);
+            else if (key == "class")
+            {
+                ok = (value == "P" || value == "S");
+                rule.seatClassMask = 1 << (value == "P" ? Seat::PREMIUM : Seat::STANDARD);
+            }
+            else if (key == "rows")
+            {
+                ok = (value.size() == 3 && value[1] == '-' && value[0] >= 'A' && value[2] <= 'Z' && value[0] <= value[2]);
+                rule.firstRow = value[0] - 'A';
+                rule.lastRow = value.back() - 'A';
+            }
+            else if (key == "occupancy")
+            {
+                ok = parseWholeNumber(value, number) && number >= 0 && number <= 100;
+                rule.minOccupancy = static_cast<int>(number);
+            }
+            else if (key == "promo")
+                rule.promoCode = string(value);
+            else if (key == "seats")
+            {
+                ok = parseWholeNumber(value, number) && number > 0 && number <= 1000;
+                rule.minSeats = static_cast<int>(number);
+            }
+            else if (key == "food")
+                ok = rule.hasMinFood = parseRupees(value, rule.minFood);
+            else if (!hasEffect && (key == "seat" || key == "price"))
+            {
+                hasEffect = true;
+                ok = parseAdjustment(value, isPercent, number) && (key == "seat" || (!isPercent && number >= 0));
+                rule.value = number;
+                rule.effect = (key == "price" ? PricingRule::SEAT_PRICE
+                               : isPercent    ? PricingRule::SEAT_PERCENT
+                                              : PricingRule::SEAT_AMOUNT);
+            }
+            else if (!hasEffect && (key == "tickets" || key == "foodoff" || key == "order"))
+            {
+                // Discounts are written as negative adjustments; order= is an amount, the others percentages.
+                hasEffect = true;
+                ok = parseAdjustment(value, isPercent, number) && number <= 0 && isPercent == (key != "order");
+                rule.value = -number;
+                rule.effect = (key == "tickets" ? PricingRule::TICKETS_PERCENT_OFF
+                               : key == "foodoff" ? PricingRule::FOOD_PERCENT_OFF
+                                                  : PricingRule::ORDER_AMOUNT_OFF);
+            }
+            else
+                ok = false;
+
+            if (!ok)
+            {
+                error = "invalid setting '" + string(token) + "'";
+                return false;
+            }
+        }
+
+        if (rule.name.empty() || !hasEffect)
+        {
+            error = "a rule needs a name and one effect";
+            return false;
+        }
+        if (rule.isSeatRule() && (!rule.promoCode.empty() || rule.minSeats > 0 || rule.hasMinFood))
+        {
+            error = "promo, seats and food conditions only apply to order effects";
+            return false;
+        }
+        return true;
+    }
+
+    // Appends the rules in path to the defaults. A missing file is not an error.
+    void loadRules(const string &path)
+    {
+        ifstream inFile(path);
+        string line;
+        int lineNumber = 0;
+        while (getline(inFile, line))
+        {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            PricingRule rule;
+            string error;
+            if (parseRule(line, rule, error))
+                rules.push_back(rule);
+            else
+                cerr << "[System Error] " << path << ":" << lineNumber << ": " << error << endl;
+        }
+    }
+
+    // Resolves everything known at schedule time (day, start time, seat
+    // class and row) and keeps one price column per occupancy threshold.
+    const ShowPricing *compile(const Showtime &show)
+    {
+        const Theater &theater = show.getTheater();
+        const SeatLayout &layout = theater.getSeatLayout();
+        int weekday = weekdayOf(show.getDate());
+        int startMinute;
+        if (!parseClockTime(show.getTime(), startMinute))
+            startMinute = -1;
+
+        lock_guard<mutex> lock(compileMutex);
+        TableKey key{(uint64_t(layout.getRowCount()) << 32) | (uint64_t(layout.getPremiumRows()) << 24) |
+                         (uint64_t(weekday + 1) << 16) | uint64_t(startMinute + 1),
+                     theater.getTicketPrice(Seat::STANDARD).getPaise(), theater.getTicketPrice(Seat::PREMIUM).getPaise()};
+        auto cached = compiledByKey.find(key);
+        if (cached != compiledByKey.end())
+            return cached->second;
+
+        auto pricing = make_unique<ShowPricing>(layout.getRowCount());
+        vector<const PricingRule *> seatRules;
+        for (const PricingRule &rule : rules)
+        {
+            if (!appliesToShow(rule, weekday, startMinute))
+                continue;
+            if (!rule.isSeatRule())
+                pricing->orderRules.push_back(rule);
+            else
+            {
+                seatRules.push_back(&rule);
+                if (rule.minOccupancy > 0)
+                    pricing->occupancyBreaks.push_back(rule.minOccupancy);
+            }
+        }
+        vector<int> &breaks = pricing->occupancyBreaks;
+        sort(breaks.begin(), breaks.end());
+        breaks.erase(unique(breaks.begin(), breaks.end()), breaks.end());
+
+        pricing->rowPrices.reserve((breaks.size() + 1) * layout.getRowCount());
+        for (size_t band = 0; band <= breaks.size(); ++band)
+        {
+            int occupancy = (band == 0 ? 0 : breaks[band - 1]);
+            for (int row = 0; row < layout.getRowCount(); ++row)
+            {
+                Seat::Type type = layout.getRowType(row);
+                Money price = theater.getTicketPrice(type);
+                for (const PricingRule *rule : seatRules)
+                {
+                    if ((rule->seatClassMask & (1 << type)) && row >= rule->firstRow && row <= rule->lastRow &&
+                        occupancy >= rule->minOccupancy)
+                    {
+                        price = applySeatRule(*rule, price);
+                    }
+                }
+                pricing->rowPrices.push_back(price);
+            }
+        }
+
+        compiled.push_back(move(pricing));
+        compiledByKey.emplace(key, compiled.back().get());
+        return compiled.back().get();
+    }
+};
+
+class PriceCalculator
+{
+public:
+    
+    // Ticket revenue booked so far for the show plus the given food order.
+    static Money calculateTotalRevenue(const Showtime &show, const FoodOrder &order)
+    {
+        Money ticketRevenue = show.getCounters().ticketRevenue();
+
+        // Access private member of FoodOrder
+        Money foodRevenue = order.totalFoodPrice;
+
+        return ticketRevenue + foodRevenue;
+    }
+
+    static double calculateOccupancyRate(const Showtime &show)
+    {
+        const SeatInventory &seats = show.getSeatInventory();
+        int totalSeats = seats.layout->getCapacity();
+        int bookedSeats = seats.countBooked();
+
+        return totalSeats > 0 ? (bookedSeats * 100.0) / totalSeats : 0.0;
+    }
+
+    // Across every show scheduled at the theater.
+    static double calculateOccupancyRate(const Theater &theater)
+    {
+        int totalSeats = theater.getCapacity() * theater.getShowtimeCount();
+        int bookedSeats = theater.getCounters().bookedSeats();
+
+        return totalSeats > 0 ? (bookedSeats * 100.0) / totalSeats : 0.0;
+    }
+
+    static Money calculateTotalRevenue(const Theater &theater)
+    {
+        return theater.getCounters().netRevenue();
+    }
+};
+
+// A booking keeps its seats as seat indices. They, its food order and its
+// discount label live in the memory resource it is built with, so a
+// confirmation can build it in a transaction arena; copies use the default
+// resource.
+class Booking
+{
+private:
+    int bookingId;
+    Showtime *showtimePtr;
+    pmr::vector<uint16_t> seatIndices;
+    FoodOrder foodOrder;
+    Money ticketTotal;
+    Money grandTotal;
+    Money appliedDiscount;
+    pmr::string discountLabel;
+
+    // Seats are priced at the occupancy the show had before this booking.
+    void calculateTicketTotal(const SeatLayout &layout, string_view promoCode)
+    {
+        const ShowPricing &pricing = showtimePtr->getPricing();
+        int bookedBefore = showtimePtr->getSeatInventory().countBooked() - static_cast<int>(seatIndices.size());
+        int occupancy = max(0, bookedBefore) * 100 / max(1, layout.getCapacity());
+
+        ticketTotal = Money();
+        for (uint16_t seatIndex : seatIndices)
+        {
+            int row, column;
+            if (layout.getSeatPosition(seatIndex, row, column))
+            {
+                ticketTotal += pricing.getSeatPrice(row, occupancy);
+            }
+        }
+
+      
+        appliedDiscount = pricing.getOrderDiscount(static_cast<int>(seatIndices.size()), ticketTotal, foodOrder,
+                                                   promoCode, discountLabel);
+
+        grandTotal = ticketTotal + foodOrder.getTotalPrice() - appliedDiscount;
+    }
+
+    void printSeats() const
+    {
+        const SeatLayout &layout = showtimePtr->getTheater().getSeatLayout();
+        for (size_t i = 0; i < seatIndices.size(); ++i)
+        {
+            cout << layout.getSeatId(seatIndices[i]) << (i < seatIndices.size() - 1 ? ", " : "");
+        }
+    }
+
+public:
+    // Prices a new booking at the show's current rules. The id comes from
+    // BookingEngine, which encodes the booking's shard in it.
+    Booking(int id, Showtime &s, span<const uint16_t> seats, const FoodOrder &order, string_view promoCode = {},
+            pmr::memory_resource *resource = pmr::get_default_resource())
+        : bookingId(id), showtimePtr(&s), seatIndices(seats.begin(), seats.end(), resource), foodOrder(order, resource),
+          discountLabel(resource)
+    {
+        calculateTicketTotal(s.getTheater().getSeatLayout(), promoCode);
+    }
+
+    // Restores a stored booking at the totals it was billed with.
+    Booking(int id, Showtime &s, span<const uint16_t> seats, const FoodOrder &order, Money tickets, Money discount,
+            pmr::memory_resource *resource = pmr::get_default_resource())
+        : bookingId(id), showtimePtr(&s), seatIndices(seats.begin(), seats.end(), resource), foodOrder(order, resource),
+          ticketTotal(tickets), appliedDiscount(discount), discountLabel(resource)
+    {
+        grandTotal = ticketTotal + foodOrder.getTotalPrice() - appliedDiscount;
+    }
+
+    int getId() const { return bookingId; }
+    Money getTicketTotal() const { return ticketTotal; }
+    Money getAppliedDiscount() const { return appliedDiscount; }
+    Money getGrandTotal() const { return grandTotal; }
+    const FoodOrder &getFoodOrder() const { return foodOrder; }
+    ShowtimeId getShowtimeId() const { return showtimePtr->getId(); }
+    const Showtime &getShowtime() const { return *showtimePtr; }
+    span<const uint16_t> getSeatIndices() const { return seatIndices; }
+
+    void generateBill() const
+    {
+        StageTimer timer(Stage::GENERATE_BILL);
+        printHeader("BOOKING CONFIRMATION & BILL");
+        cout << "Reference ID: " << bookingId << endl;
+        cout << LINE_SEPARATOR << endl;
+
+        cout << left << setw(20) << "Movie:" << getShowtime().getMovie().getTitle() << endl;
+        cout << left << setw(20) << "Theater:" << getShowtime().getTheater().getName()
+             << " (" << getShowtime().getTheater().getCity() << ")" << endl;
+        cout << left << setw(20) << "Show Time:" << getShowtime().getDate() << " at " << getShowtime().getTime() << endl;
+        cout << LINE_SEPARATOR << endl;
+
+        cout << "Ticket Details:" << endl;
+        cout << "  Seats Reserved (" << seatIndices.size() << "): ";
+        printSeats();
+        cout << endl;
+        cout << left << setw(20) << "  Ticket Subtotal:" << "Rs " << formatCurrency(ticketTotal) << endl;
+
+        foodOrder.displayOrder();
+
+        if (appliedDiscount > Money())
+        {
+            cout << "\n    ** SPECIAL DISCOUNT APPLIED (" << discountLabel << ") **" << endl;
+            cout << "    Discount Amount: Rs " << formatCurrency(appliedDiscount) << endl;
+        }
+
+        cout << LINE_SEPARATOR << endl;
+        cout << ">> " << left << setw(20) << "GRAND TOTAL:" << "Rs " << formatCurrency(grandTotal) << endl;
+        cout << LINE_SEPARATOR << endl;
+
+        double occupancy = PriceCalculator::calculateOccupancyRate(getShowtime());
+        cout << "Theater Occupancy: " << fixed << setprecision(1) << occupancy << "%" << endl;
+        cout << "Enjoy your movie! Seats are confirmed." << endl;
+    }
+
+    void cancel() const
+    {
+        SeatInventory &seats = showtimePtr->getSeatInventory();
+        const SeatLayout &layout = seats.getLayout();
+
+        for (uint16_t seatIndex : seatIndices)
+        {
+            int row, column;
+            if (layout.getSeatPosition(seatIndex, row, column))
+            {
+                seats.release(row, column);
+            }
+        }
+    }
+
+    void displayBriefDetails() const
+    {
+        cout << "  [ID: " << bookingId << "] "
+             << getShowtime().getMovie().getTitle()
+             << " at " << getShowtime().getTime()
+             << " on " << getShowtime().getDate()
+             << " (" << getShowtime().getTheater().getName() << ")" << endl;
+        cout << "    Seats: ";
+        printSeats();
+        cout << endl;
+    }
+};
+
+// One ordered food item: index into the theater menu and quantity.
+struct FoodLine
+{
+    uint16_t itemId;
+    uint16_t quantity;
+};
+
+// Live bookings as parallel fixed-width columns. Seat indices and food lines
+// of every booking sit back to back in two shared arenas, addressed by
+// offset and count, so a scan walks contiguous memory instead of chasing
+// per-booking heap objects. Rows are kept in id order, so a booking is found
+// by binary search with no index to build; new ids are always the highest,
+// so bookings are appended. Cancelled rows are tombstoned (id negated) and
+// squeezed out once they make up half the store; row numbers are only
+// stable between mutations.
+class BookingStore
+{
+private:
+    vector<int32_t> ids;
+    vector<ShowtimeId> showtimeIds;
+    vector<uint32_t> seatOffsets;
+    vector<uint16_t> seatCounts;
+    vector<uint32_t> foodOffsets;
+    vector<uint16_t> foodCounts;
+    vector<int32_t> ticketPaise;
+    vector<int32_t> foodPaise;
+    vector<int32_t> discountPaise;
+    vector<uint16_t> seatArena;
+    vector<FoodLine> foodArena;
+    size_t deadRows;
+
+    // The first row whose id is not below bookingId, live or not.
+    uint32_t lowerRow(int bookingId) const
+    {
+        auto it = partition_point(ids.begin(), ids.end(), [bookingId](int32_t id) { return (id < 0 ? -id : id) < bookingId; });
+        return static_cast<uint32_t>(it - ids.begin());
+    }
+
+    template <typename T>
+    static void insertAt(vector<T> &column, uint32_t row, T value)
+    {
+        if (row == column.size())
+            column.push_back(value);
+        else
+            column.insert(column.begin() + row, value);
+    }
+
+    template <typename T>
+    static void moveDown(vector<T> &arena, uint32_t from, uint16_t count, uint32_t to)
+    {
+        if (from != to)
+            copy(arena.begin() + from, arena.begin() + from + count, arena.begin() + to);
+    }
+
+    // Drops the tombstoned rows in place. Columns keep their capacity, so a
+    // store churning through bookings and cancellations stops allocating
+    // once it has reached its largest size. Seats and food lines can only
+    // move down when they are stored in row order, as in any store built by
+    // appending; a store with older ids inserted in the middle is rebuilt.
+    void compact()
+    {
+        if (!is_sorted(seatOffsets.begin(), seatOffsets.end()) || !is_sorted(foodOffsets.begin(), foodOffsets.end()))
+        {
+            rebuild();
+            return;
+        }
+
+        uint32_t kept = 0;
+        uint32_t seatEnd = 0;
+        uint32_t foodEnd = 0;
+        for (uint32_t row = 0; row < ids.size(); ++row)
+        {
+            if (!isLive(row))
+                continue;
+            moveDown(seatArena, seatOffsets[row], seatCounts[row], seatEnd);
+            moveDown(foodArena, foodOffsets[row], foodCounts[row], foodEnd);
+            ids[kept] = ids[row];
+            showtimeIds[kept] = showtimeIds[row];
+            seatOffsets[kept] = seatEnd;
+            seatCounts[kept] = seatCounts[row];
+            foodOffsets[kept] = foodEnd;
+            foodCounts[kept] = foodCounts[row];
+            ticketPaise[kept] = ticketPaise[row];
+            foodPaise[kept] = foodPaise[row];
+            discountPaise[kept] = discountPaise[row];
+            seatEnd += seatCounts[kept];
+            foodEnd += foodCounts[kept];
+            kept++;
+        }
+
+        ids.resize(kept);
+        showtimeIds.resize(kept);
+        seatOffsets.resize(kept);
+        seatCounts.resize(kept);
+        foodOffsets.resize(kept);
+        foodCounts.resize(kept);
+        ticketPaise.resize(kept);
+        foodPaise.resize(kept);
+        discountPaise.resize(kept);
+        seatArena.resize(seatEnd);
+        foodArena.resize(foodEnd);
+        deadRows = 0;
+    }
+
+    void rebuild()
+    {
+        BookingStore live;
+        live.reserve(size(), seatArena.size(), foodArena.size());
+        for (uint32_t row = 0; row < ids.size(); ++row)
+        {
+            if (isLive(row))
+            {
+                live.append(ids[row], showtimeIds[row], getSeats(row), getFood(row),
+                            ticketPaise[row], foodPaise[row], discountPaise[row]);
+            }
+        }
+        *this = std::move(live);
+    }
+
+public:
+    BookingStore() : deadRows(0) {}
+
+    size_t size() const { return ids.size() - deadRows; }
+    uint32_t getRowCount() const { return static_cast<uint32_t>(ids.size()); }
+    bool isLive(uint32_t row) const { return ids[row] > 0; }
+    bool contains(int bookingId) const { return findRow(bookingId) >= 0; }
+    int getLastId() const { return ids.empty() ? 0 : abs(ids.back()); }
+
+    // -1 when the booking is not in the store.
+    long findRow(int bookingId) const
+    {
+        uint32_t row = lowerRow(bookingId);
+        return (row < ids.size() && ids[row] == bookingId ? static_cast<long>(row) : -1);
+    }
+
+    void reserve(size_t bookings, size_t seats, size_t foodLines)
+    {
+        ids.reserve(bookings);
+        showtimeIds.reserve(bookings);
+        seatOffsets.reserve(bookings);
+        seatCounts.reserve(bookings);
+        foodOffsets.reserve(bookings);
+        foodCounts.reserve(bookings);
+        ticketPaise.reserve(bookings);
+        foodPaise.reserve(bookings);
+        discountPaise.reserve(bookings);
+        seatArena.reserve(seats);
+        foodArena.reserve(foodLines);
+    }
+
+    // Adds a booking whose id (positive) is not in the store yet. Ids above
+    // every stored one go at the end; older ids, which only come from files
+    // written before ids were allocated per shard, are inserted in order.
+    uint32_t append(int bookingId, ShowtimeId showId, span<const uint16_t> seats, span<const FoodLine> food,
+                    int32_t tickets, int32_t foodTotal, int32_t discount)
+    {
+        uint32_t row = (bookingId > getLastId() ? static_cast<uint32_t>(ids.size()) : lowerRow(bookingId));
+        insertAt(ids, row, static_cast<int32_t>(bookingId));
+        insertAt(showtimeIds, row, showId);
+        insertAt(seatOffsets, row, static_cast<uint32_t>(seatArena.size()));
+        insertAt(seatCounts, row, static_cast<uint16_t>(seats.size()));
+        insertAt(foodOffsets, row, static_cast<uint32_t>(foodArena.size()));
+        insertAt(foodCounts, row, static_cast<uint16_t>(food.size()));
+        insertAt(ticketPaise, row, tickets);
+        insertAt(foodPaise, row, foodTotal);
+        insertAt(discountPaise, row, discount);
+        seatArena.insert(seatArena.end(), seats.begin(), seats.end());
+        foodArena.insert(foodArena.end(), food.begin(), food.end());
+        return row;
+    }
+
+    void erase(uint32_t row)
+    {
+        ids[row] = -ids[row];
+        deadRows++;
+        if (deadRows >= 1024 && deadRows * 2 >= ids.size())
+        {
+            compact();
+        }
+    }
+
+    int getId(uint32_t row) const { return ids[row]; }
+    ShowtimeId getShowtimeId(uint32_t row) const { return showtimeIds[row]; }
+    span<const uint16_t> getSeats(uint32_t row) const { return {seatArena.data() + seatOffsets[row], seatCounts[row]}; }
+    span<const FoodLine> getFood(uint32_t row) const { return {foodArena.data() + foodOffsets[row], foodCounts[row]}; }
+    int32_t getTicketPaise(uint32_t row) const { return ticketPaise[row]; }
+    int32_t getFoodPaise(uint32_t row) const { return foodPaise[row]; }
+    int32_t getDiscountPaise(uint32_t row) const { return discountPaise[row]; }
+};
+
+// Unsigned LEB128 varints. Signed values are zigzag-mapped first so small
+// negative deltas stay one byte.
+void appendVarint(string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+bool readVarint(const char *&pos, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7)
+    {
+        uint8_t byte = static_cast<uint8_t>(*pos++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+constexpr uint64_t zigzagEncode(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+constexpr int64_t zigzagDecode(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+// One stored booking: seats as SeatLayout indices, food as menu positions
+// and the totals it was billed at.
+struct BookingRecord
+{
+    int32_t bookingId = 0;
+    ShowtimeId showtimeId = 0;
+    span<const uint16_t> seats;
+    span<const FoodLine> food;
+    int32_t ticketPaise = 0;
+    int32_t foodPaise = 0;
+    int32_t discountPaise = 0;
+};
+
+// Varint encoding of a stream of BookingRecords:
+//   id, showtime, seat count, seat..., food count, (item, quantity)...,
+//   ticket paise, food paise, discount paise
+// Ids and showtimes are zigzag deltas from the previous record and seats from
+// the previous seat, so a two-seat booking takes about ten bytes. Decoding
+// reuses the codec's buffers and does not allocate once they have grown.
+class BookingRecordCodec
+{
+private:
+    int64_t lastId = 0;
+    int64_t lastShowtime = 0;
+    vector<uint16_t> seatBuffer;
+    vector<FoodLine> foodBuffer;
+
+    static bool readSigned(const char *&pos, const char *end, int64_t &value)
+    {
+        uint64_t raw;
+        if (!readVarint(pos, end, raw))
+            return false;
+        value = zigzagDecode(raw);
+        return true;
+    }
+
+    static bool readInt32(const char *&pos, const char *end, int32_t &value)
+    {
+        int64_t wide;
+        if (!readSigned(pos, end, wide) || wide < numeric_limits<int32_t>::min() || wide > numeric_limits<int32_t>::max())
+            return false;
+        value = static_cast<int32_t>(wide);
+        return true;
+    }
+
+    static bool readCount(const char *&pos, const char *end, uint64_t limit, uint64_t &value)
+    {
+        return readVarint(pos, end, value) && value <= limit;
+    }
+
+public:
+    // Starts a new stream; the next record is encoded without deltas.
+    void reset()
+    {
+        lastId = 0;
+        lastShowtime = 0;
+    }
+
+    void encode(const BookingRecord &record, string &out)
+    {
+        appendVarint(out, zigzagEncode(record.bookingId - lastId));
+        appendVarint(out, zigzagEncode(static_cast<int64_t>(record.showtimeId) - lastShowtime));
+        lastId = record.bookingId;
+        lastShowtime = record.showtimeId;
+
+        appendVarint(out, record.seats.size());
+        int64_t lastSeat = 0;
+        for (uint16_t seat : record.seats)
+        {
+            appendVarint(out, zigzagEncode(seat - lastSeat));
+            lastSeat = seat;
+        }
+        appendVarint(out, record.food.size());
+        for (const FoodLine &line : record.food)
+        {
+            appendVarint(out, line.itemId);
+            appendVarint(out, line.quantity);
+        }
+        appendVarint(out, zigzagEncode(record.ticketPaise));
+        appendVarint(out, zigzagEncode(record.foodPaise));
+        appendVarint(out, zigzagEncode(record.discountPaise));
+    }
+
+    // The record's seat and food spans point into the codec and stay valid
+    // until the next decode. False on a truncated or out-of-range record.
+    bool decode(const char *&pos, const char *end, BookingRecord &record)
+    {
+        int64_t idDelta, showtimeDelta;
+        uint64_t seatCount, foodCount;
+        if (!readSigned(pos, end, idDelta) || !readSigned(pos, end, showtimeDelta) ||
+            !readCount(pos, end, numeric_limits<uint16_t>::max(), seatCount))
+        {
+            return false;
+        }
+        int64_t id = lastId + idDelta;
+        int64_t showtime = lastShowtime + showtimeDelta;
+        if (id <= 0 || id > numeric_limits<int32_t>::max() || showtime < 0 || showtime > numeric_limits<ShowtimeId>::max())
+            return false;
+
+        seatBuffer.resize(seatCount);
+        int64_t seat = 0;
+        for (uint16_t &slot : seatBuffer)
+        {
+            int64_t delta;
+            if (!readSigned(pos, end, delta))
+                return false;
+            seat += delta;
+            if (seat < 0 || seat > numeric_limits<uint16_t>::max())
+                return false;
+            slot = static_cast<uint16_t>(seat);
+        }
+
+        if (!readCount(pos, end, numeric_limits<uint16_t>::max(), foodCount))
+            return false;
+        foodBuffer.resize(foodCount);
+        for (FoodLine &line : foodBuffer)
+        {
+            uint64_t item, quantity;
+            if (!readCount(pos, end, numeric_limits<uint16_t>::max(), item) ||
+                !readCount(pos, end, numeric_limits<uint16_t>::max(), quantity))
+            {
+                return false;
+            }
+            line = {static_cast<uint16_t>(item), static_cast<uint16_t>(quantity)};
+        }
+
+        if (!readInt32(pos, end, record.ticketPaise) || !readInt32(pos, end, record.foodPaise) ||
+            !readInt32(pos, end, record.discountPaise))
+        {
+            return false;
+        }
+        record.bookingId = static_cast<int32_t>(id);
+        record.showtimeId = static_cast<ShowtimeId>(showtime);
+        record.seats = seatBuffer;
+        record.food = foodBuffer;
+        lastId = id;
+        lastShowtime = showtime;
+        return true;
+    }
+};
+
+// Records from before journal sequence numbers, with the payloads of
+// JOURNAL_CREATED and JOURNAL_CANCELLED minus the shard and sequence.
+const char JOURNAL_CREATED_V1 = 1;
+const char JOURNAL_CANCELLED_V1 = 2;
+const char JOURNAL_CREATED = 3;
+const char JOURNAL_CANCELLED = 4;
+
+// Append-only log of booking changes made since the last snapshot of
+// BOOKING_SNAPSHOT_FILE. Records are appended a group at a time with one
+// fsync per group. A record is a kind byte, the payload length as a varint,
+// then the payload, which starts with the booking shard (one byte) and the
+// record's sequence number within that shard (varint):
+//   JOURNAL_CREATED    shard, sequence, show key length, show key,
+//                      one BookingRecordCodec record
+//   JOURNAL_CANCELLED  shard, sequence, booking id
+// The snapshot stores the last sequence it covers for each shard, so replay
+// skips records the snapshot already holds even if the journal was not
+// truncated after it.
+//
+// Before a snapshot is taken the journal is rotated: the records so far move
+// to a retired file (path + ".old"), which is deleted once the snapshot is
+// on disk, while new records go to a fresh file. Replay reads both.
+class BookingJournal
+{
+private:
+    string path;
+    string retiredPath;
+    FILE *file;
+    size_t recordBytes;
+
+public:
+    explicit BookingJournal(const string &p) : path(p), retiredPath(p + ".old"), file(nullptr), recordBytes(0) {}
+
+    BookingJournal(const BookingJournal &) = delete;
+    BookingJournal &operator=(const BookingJournal &) = delete;
+
+    ~BookingJournal()
+    {
+        close();
+    }
+
+    bool open()
+    {
+        close();
+        file = fopen(path.c_str(), "ab");
+        return file != nullptr;
+    }
+
+    void close()
+    {
+        if (file)
+        {
+            syncFile(file);
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    // Starts a record's payload with its shard and sequence number.
+    static void appendRecordHeader(string &payload, size_t shard, uint64_t sequence)
+    {
+        payload += static_cast<char>(shard);
+        appendVarint(payload, sequence);
+    }
+
+    // Splits off the shard and sequence number; false if they are unreadable.
+    static bool readRecordHeader(string_view &payload, size_t &shard, uint64_t &sequence)
+    {
+        const char *pos = payload.data();
+        const char *end = pos + payload.size();
+        if (pos == end)
+            return false;
+        shard = static_cast<unsigned char>(*pos++);
+        if (!readVarint(pos, end, sequence))
+            return false;
+        payload.remove_prefix(pos - payload.data());
+        return true;
+    }
+
+    // Appends one record: its kind, the payload's length and the payload.
+    static void appendRecord(string &out, char kind, string_view payload)
+    {
+        out += kind;
+        appendVarint(out, payload.size());
+        out += payload;
+    }
+
+    // Writes a group of complete records and makes them durable.
+    bool append(string_view records)
+    {
+        if (!file)
+            return false;
+        return fwrite(records.data(), 1, records.size(), file) == records.size() && fflush(file) == 0 && syncFile(file);
+    }
+
+    // Bytes of complete records read back by the last readRecords().
+    size_t getRecordBytes() const { return recordBytes; }
+
+    // Calls visit(kind, payload) for every complete record, oldest first:
+    // the retired file's, then the current file's.
+    // Text lines from older journals ("B|<id|show key|seats>", "C|<id>") come
+    // through as kind 'B' or 'C'. A torn record left by a crash mid-write is
+    // cut from the file so later appends start on a record boundary.
+    template <typename Visitor>
+    void readRecords(Visitor visit)
+    {
+        recordBytes = 0;
+        readFile(retiredPath, visit);
+        readFile(path, visit);
+    }
+
+    // Moves the records written so far to the retired file and starts an
+    // empty journal. If a retired file is still there because the snapshot
+    // meant to replace it failed, the records are appended to it instead.
+    bool rotate()
+    {
+        close();
+        error_code ec;
+        if (!filesystem::exists(retiredPath, ec))
+        {
+            filesystem::rename(path, retiredPath, ec);
+        }
+        else
+        {
+            ifstream inFile(path, ios::binary);
+            string records((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+            inFile.close();
+            FILE *retired = fopen(retiredPath.c_str(), "ab");
+            bool moved = retired && fwrite(records.data(), 1, records.size(), retired) == records.size();
+            moved = retired && syncFile(retired) && moved;
+            if (retired)
+                fclose(retired);
+            // Records left behind on failure are skipped by their sequence
+            // numbers if they were copied in part.
+            if (moved)
+                filesystem::remove(path, ec);
+        }
+        return open();
+    }
+
+    // Deletes the retired records once a snapshot holding them is on disk.
+    void discardRetired()
+    {
+        error_code ec;
+        filesystem::remove(retiredPath, ec);
+    }
+
+private:
+    template <typename Visitor>
+    void readFile(const string &filePath, Visitor &visit)
+    {
+        ifstream inFile(filePath, ios::binary);
+        if (!inFile.is_open())
+        {
+            return;
+        }
+
+        string contents((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+        inFile.close();
+
+        const char *begin = contents.data();
+        const char *end = begin + contents.size();
+        const char *pos = begin;
+        while (pos < end)
+        {
+            char kind = *pos;
+            if (kind >= JOURNAL_CREATED_V1 && kind <= JOURNAL_CANCELLED)
+            {
+                const char *payload = pos + 1;
+                uint64_t length;
+                if (!readVarint(payload, end, length) || length > static_cast<uint64_t>(end - payload))
+                    break;
+                visit(kind, string_view(payload, length));
+                pos = payload + length;
+            }
+            else
+            {
+                const char *newline = find(pos, end, '\n');
+                if (newline == end)
+                    break;
+                if (newline - pos > 2 && pos[1] == '|')
+                    visit(kind, string_view(pos + 2, newline - pos - 2));
+                pos = newline + 1;
+            }
+        }
+        recordBytes += pos - begin;
+
+        if (pos < end)
+        {
+            error_code ec;
+            filesystem::resize_file(filePath, pos - begin, ec);
+        }
+    }
+};
+
+// Persistence stage between the booking path and the disk. Booking shards
+// push journal records and snapshots into a bounded multi-producer ring;
+// each slot carries a sequence number that tells producers when it is free
+// and the writer when it is filled. The writer thread takes every filled
+// slot in order, appends the records with one write and one fsync (group
+// commit), writes any snapshot in order, and then publishes the sequence
+// number up to which the queue is durable.
+class JournalWriter
+{
+public:
+    enum class Kind
+    {
+        RECORDS,
+        ROTATE,
+        SNAPSHOT,
+        STOP
+    };
+
+private:
+    // Slot n of lap k holds the entry pushed as number n + k * capacity:
+    // its sequence is that number while free, and the number + 1 once filled.
+    struct Entry
+    {
+        atomic<uint64_t> sequence{0};
+        Kind kind = Kind::RECORDS;
+        string bytes;
+    };
+
+    BookingJournal &journal;
+    string snapshotPath;
+    vector<Entry> ring;
+    atomic<uint64_t> tail;    // entries claimed; entry n has sequence n + 1
+    atomic<uint64_t> durable; // highest sequence written and synced
+    thread writer;
+
+    void commit(string &group)
+    {
+        if (group.empty())
+            return;
+        if (!journal.append(group))
+        {
+            cerr << "\n[System Error] Unable to record bookings in journal" << endl;
+        }
+        group.clear();
+    }
+
+    // Swaps in a snapshot covering every record queued before the last
+    // ROTATE, then deletes the retired journal holding those records.
+    void writeSnapshot(const string &snapshot)
+    {
+        if (writeFileAtomically(snapshotPath, snapshot))
+        {
+            journal.discardRetired();
+            return;
+        }
+        cerr << "\n[System Error] Unable to save booking data to file: " << snapshotPath << endl;
+    }
+
+    void run()
+    {
+        string group;
+        uint64_t next = 0;
+        bool stopping = false;
+        while (!stopping)
+        {
+            Entry &first = ring[next % ring.size()];
+            uint64_t seen;
+            while ((seen = first.sequence.load(memory_order_acquire)) != next + 1)
+            {
+                first.sequence.wait(seen, memory_order_acquire);
+            }
+
+            for (;;)
+            {
+                Entry &entry = ring[next % ring.size()];
+                if (stopping || entry.sequence.load(memory_order_acquire) != next + 1)
+                    break;
+                if (entry.kind == Kind::RECORDS)
+                {
+                    group += entry.bytes;
+                }
+                else
+                {
+                    commit(group);
+                    if (entry.kind == Kind::ROTATE && !journal.rotate())
+                        cerr << "\n[System Error] Unable to start a new booking journal" << endl;
+                    else if (entry.kind == Kind::SNAPSHOT)
+                        writeSnapshot(entry.bytes);
+                    else if (entry.kind == Kind::STOP)
+                        stopping = true;
+                }
+                // Record slots keep their buffers for the next lap; a
+                // snapshot's is freed.
+                if (entry.kind == Kind::RECORDS)
+                    entry.bytes.clear();
+                else
+                    entry.bytes = string();
+                entry.sequence.store(next + ring.size(), memory_order_release);
+                entry.sequence.notify_all();
+                ++next;
+            }
+            commit(group);
+
+            durable.store(next, memory_order_release);
+            durable.notify_all();
+        }
+    }
+
+public:
+    JournalWriter(BookingJournal &j, const string &snapshotFile)
+        : journal(j), snapshotPath(snapshotFile), ring(JOURNAL_QUEUE_CAPACITY), tail(0), durable(0)
+    {
+        for (size_t n = 0; n < ring.size(); ++n)
+        {
+            ring[n].sequence.store(n, memory_order_relaxed);
+            ring[n].bytes.reserve(JOURNAL_SLOT_BYTES);
+        }
+        writer = thread(&JournalWriter::run, this);
+    }
+
+    JournalWriter(const JournalWriter &) = delete;
+    JournalWriter &operator=(const JournalWriter &) = delete;
+
+    ~JournalWriter()
+    {
+        stop();
+    }
+
+    // Queues bytes for the writer and returns their sequence number. Blocks
+    // while the ring is full. Entries from one thread keep their order;
+    // callers order entries across threads with their own locks.
+    uint64_t push(Kind kind, string bytes)
+    {
+        uint64_t number;
+        Entry &entry = claim(number);
+        entry.kind = kind;
+        entry.bytes = move(bytes);
+        return publish(entry, number);
+    }
+
+    // Queues a journal record that encode(string &) appends straight into
+    // its slot's buffer, so once the ring has warmed up records are queued
+    // without allocating.
+    template <typename Encoder>
+    uint64_t pushRecord(Encoder encode)
+    {
+        uint64_t number;
+        Entry &entry = claim(number);
+        entry.kind = Kind::RECORDS;
+        encode(entry.bytes);
+        return publish(entry, number);
+    }
+
+    uint64_t getDurableSequence() const { return durable.load(memory_order_acquire); }
+
+private:
+    // Takes the next slot, waiting while the writer still holds it.
+    Entry &claim(uint64_t &number)
+    {
+        number = tail.fetch_add(1, memory_order_relaxed);
+        Entry &entry = ring[number % ring.size()];
+        uint64_t seen;
+        while ((seen = entry.sequence.load(memory_order_acquire)) != number)
+        {
+            entry.sequence.wait(seen, memory_order_acquire);
+        }
+        return entry;
+    }
+
+    uint64_t publish(Entry &entry, uint64_t number)
+    {
+        entry.sequence.store(number + 1, memory_order_release);
+        entry.sequence.notify_all();
+        return number + 1;
+    }
+
+public:
+    void waitUntilDurable(uint64_t sequence) const
+    {
+        uint64_t reached;
+        while ((reached = durable.load(memory_order_acquire)) < sequence)
+        {
+            durable.wait(reached, memory_order_acquire);
+        }
+    }
+
+    // Drains the queue and joins the writer.
+    void stop()
+    {
+        if (writer.joinable())
+        {
+            push(Kind::STOP, string());
+            writer.join();
+        }
+    }
+};
+
+// On-disk layout of BOOKING_SNAPSHOT_FILE (native byte order). Every section
+// starts on an 8-byte boundary so it can be used straight from the mapping:
+//   SnapshotHeader
+//   SnapshotShard[shardCount]          journal sequence covered, record counts and
+//                                      sizes per booking shard
+//   SnapshotShowtime[showtimeCount]   in showtime order, matched to the catalog by key hash
+//   uint64_t words[wordCount]          booked bitmaps, one run per showtime
+//   char records[]                     each shard's BookingRecordCodec records in
+//                                      turn; every shard starts a new delta stream,
+//                                      so shards decode independently
+const char SNAPSHOT_MAGIC[4] = {'C', 'S', 'B', 'S'};
+const uint32_t SNAPSHOT_VERSION = 4;
+
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t showtimeCount;
+    uint32_t shardCount;
+    uint64_t wordCount;
+};
+
+struct SnapshotShard
+{
+    uint64_t journalSequence; // the shard's last journal record this snapshot includes
+    uint64_t bookingCount;
+    uint64_t seatCount;
+    uint64_t foodCount;
+    uint64_t recordBytes;
+};
+
+struct SnapshotShowtime
+{
+    uint64_t keyHash;
+    uint32_t wordOffset;
+    uint32_t wordCount;
+};
+
+static_assert(sizeof(SnapshotHeader) == 24 && sizeof(SnapshotShard) == 40 && sizeof(SnapshotShowtime) == 16,
+              "snapshot records must keep their on-disk size");
+
+// Transparent hash so string-keyed maps can be probed with a string_view.
+struct StringKeyHash
+{
+    using is_transparent = void;
+    size_t operator()(string_view key) const { return static_cast<size_t>(hashKey(key)); }
+};
+
+template <typename T>
+void appendBytes(string &out, const T &value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+// A hold's deadline and up to MAX_SEATS of its seats, kept inline so a hold
+// is scheduled without allocating; a larger hold takes several entries.
+struct HoldExpiry
+{
+    static const int MAX_SEATS = 8;
+
+    ShowtimeId showtimeId;
+    uint32_t token;
+    uint32_t expiryTick;
+    uint16_t seatCount;
+    uint16_t seatIndices[MAX_SEATS];
+
+    span<const uint16_t> getSeats() const { return span<const uint16_t>(seatIndices, seatCount); }
+};
+
+// Hierarchical timing wheel of hold deadlines. Level n has WHEEL_SLOTS slots of
+// WHEEL_SLOTS^n ticks each; when a slot of a higher level comes due its entries
+// cascade one level down. An entry is therefore moved at most WHEEL_LEVELS
+// times, and advancing never looks at holds that are not yet due.
+class HoldExpiryWheel
+{
+private:
+    static const int WHEEL_LEVELS = 4;
+    static const int WHEEL_SLOT_BITS = 6;
+    static const int WHEEL_SLOTS = 1 << WHEEL_SLOT_BITS;
+
+    vector<HoldExpiry> slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    vector<HoldExpiry> cascading; // swapped with a slot, so both keep their capacity
+    uint32_t currentTick;
+    size_t entryCount;
+
+    void place(HoldExpiry &&entry, vector<HoldExpiry> &due)
+    {
+        if (entry.expiryTick <= currentTick)
+        {
+            due.push_back(move(entry));
+            return;
+        }
+
+        uint32_t delta = entry.expiryTick - currentTick;
+        int level = 0;
+        while (level < WHEEL_LEVELS - 1 && delta >= (uint32_t(1) << (WHEEL_SLOT_BITS * (level + 1))))
+        {
+            level++;
+        }
+        uint32_t expiry = entry.expiryTick;
+        if (level == WHEEL_LEVELS - 1 && delta >= (uint32_t(1) << (WHEEL_SLOT_BITS * WHEEL_LEVELS)) - 1)
+        {
+            // Beyond the wheel's range: park it in the farthest slot and let it cascade again.
+            expiry = currentTick + (uint32_t(1) << (WHEEL_SLOT_BITS * WHEEL_LEVELS)) - 1;
+        }
+        int slot = (expiry >> (WHEEL_SLOT_BITS * level)) & (WHEEL_SLOTS - 1);
+        slots[level][slot].push_back(move(entry));
+        entryCount++;
+    }
+
+    void cascade(int level, vector<HoldExpiry> &due)
+    {
+        int slot = (currentTick >> (WHEEL_SLOT_BITS * level)) & (WHEEL_SLOTS - 1);
+        cascading.swap(slots[level][slot]);
+        entryCount -= cascading.size();
+        for (auto &entry : cascading)
+        {
+            place(move(entry), due);
+        }
+        cascading.clear();
+    }
+
+public:
+    explicit HoldExpiryWheel(uint32_t startTick) : currentTick(startTick), entryCount(0) {}
+
+    size_t size() const { return entryCount; }
+
+    void schedule(HoldExpiry &&entry, vector<HoldExpiry> &due)
+    {
+        place(move(entry), due);
+    }
+
+    // Moves the wheel forward to nowTick, appending every entry that came due.
+    void advance(uint32_t nowTick, vector<HoldExpiry> &due)
+    {
+        while (currentTick < nowTick)
+        {
+            currentTick++;
+            for (int level = WHEEL_LEVELS - 1; level > 0; --level)
+            {
+                if ((currentTick & ((uint32_t(1) << (WHEEL_SLOT_BITS * level)) - 1)) == 0)
+                {
+                    cascade(level, due);
+                }
+            }
+
+            vector<HoldExpiry> &slot = slots[0][currentTick & (WHEEL_SLOTS - 1)];
+            entryCount -= slot.size();
+            for (auto &entry : slot)
+            {
+                due.push_back(move(entry));
+            }
+            slot.clear();
+        }
+    }
+};
+
+// Column-per-field copy of the booking records, taken for reporting so the
+// scans touch only the fields they aggregate and never hold a shard lock.
+struct BookingColumns
+{
+    vector<ShowtimeId> showtimeIds;
+    vector<uint16_t> premiumSeats;
+    vector<uint16_t> standardSeats;
+    vector<int64_t> ticketPaise;
+    vector<int64_t> foodPaise;
+    vector<int64_t> discountPaise;
+
+    size_t size() const { return showtimeIds.size(); }
+
+    void reserve(size_t count)
+    {
+        showtimeIds.reserve(count);
+        premiumSeats.reserve(count);
+        standardSeats.reserve(count);
+        ticketPaise.reserve(count);
+        foodPaise.reserve(count);
+        discountPaise.reserve(count);
+    }
+
+    void append(const BookingStore &store, uint32_t row, int premium)
+    {
+        showtimeIds.push_back(store.getShowtimeId(row));
+        premiumSeats.push_back(static_cast<uint16_t>(premium));
+        standardSeats.push_back(static_cast<uint16_t>(store.getSeats(row).size() - premium));
+        ticketPaise.push_back(store.getTicketPaise(row));
+        foodPaise.push_back(store.getFoodPaise(row));
+        discountPaise.push_back(store.getDiscountPaise(row));
+    }
+};
+
+struct ShowStart
+{
+    int64_t minute; // minutes since the epoch, local show time
+    ShowtimeId id;
+};
+
+// Lookup structures over the catalog, updated by BookingEngine as movies,
+// theaters and showtimes are added. Ids are positions in the engine's
+// catalog. Not locked: queries run on the thread that adds to the catalog,
+// or once it stops changing.
+class CatalogIndex
+{
+private:
+    // Lowercased "title\ndirector" per movie, and for each trigram of those
+    // the movies containing it. Ids arrive in order, so lists stay sorted.
+    vector<string> searchText;
+    unordered_map<uint32_t, vector<MovieId>> trigramPostings;
+    unordered_map<string, vector<MovieId>, StringKeyHash, equal_to<>> genrePostings;
+    unordered_map<string, vector<MovieId>, StringKeyHash, equal_to<>> languagePostings;
+    vector<vector<ShowtimeId>> movieShowtimes;
+
+    unordered_map<string, vector<string>, StringKeyHash, equal_to<>> stateCities;
+    unordered_map<string, vector<TheaterId>, StringKeyHash, equal_to<>> cityTheaters;
+    vector<vector<ShowtimeId>> theaterShowtimes;
+    vector<ShowStart> showtimesByStart;
+    size_t sortedStarts = 0;
+
+    static string lowercase(string_view text)
+    {
+        string folded(text);
+        transform(folded.begin(), folded.end(), folded.begin(), [](unsigned char ch) { return static_cast<char>(tolower(ch)); });
+        return folded;
+    }
+
+    static uint32_t trigramAt(string_view text, size_t pos)
+    {
+        return static_cast<unsigned char>(text[pos]) | static_cast<unsigned char>(text[pos + 1]) << 8 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 2])) << 16;
+    }
+
+    static void post(vector<MovieId> &postings, MovieId id)
+    {
+        if (postings.empty() || postings.back() != id)
+            postings.push_back(id);
+    }
+
+    static span<const MovieId> lookup(const unordered_map<string, vector<MovieId>, StringKeyHash, equal_to<>> &postings,
+                                      string_view key)
+    {
+        auto it = postings.find(lowercase(key));
+        return it == postings.end() ? span<const MovieId>() : span<const MovieId>(it->second);
+    }
+
+public:
+    static int64_t startMinuteOf(const string &date, const string &time)
+    {
+        chrono::sys_days day;
+        int minute;
+        if (!parseCalendarDate(date, day) || !parseClockTime(time, minute))
+            return -1;
+        return static_cast<int64_t>(day.time_since_epoch().count()) * 24 * 60 + minute;
+    }
+
+    void addMovie(const Movie &movie)
+    {
+        MovieId id = movie.getId();
+        searchText.push_back(lowercase(movie.getTitle()) + '\n' + lowercase(movie.getDirector()));
+        const string &text = searchText.back();
+        for (size_t pos = 0; pos + 3 <= text.size(); ++pos)
+        {
+            post(trigramPostings[trigramAt(text, pos)], id);
+        }
+
+        // The whole genre and each of its words, so "Sci-Fi/Action" is found by "action".
+        string genre = lowercase(movie.getGenre());
+        post(genrePostings[genre], id);
+        for (size_t start = 0; start < genre.size();)
+        {
+            size_t end = min(genre.find_first_of("/ ", start), genre.size());
+            if (end > start)
+                post(genrePostings[genre.substr(start, end - start)], id);
+            start = end + 1;
+        }
+
+        post(languagePostings[lowercase(movie.getLanguage())], id);
+        movieShowtimes.emplace_back();
+    }
+
+    void addTheater(const Theater &theater)
+    {
+        vector<string> &cities = stateCities[theater.getState()];
+        if (find(cities.begin(), cities.end(), theater.getCity()) == cities.end())
+            cities.push_back(theater.getCity());
+        cityTheaters[theater.getCity()].push_back(theater.getId());
+        theaterShowtimes.emplace_back();
+    }
+
+    void addShowtime(const Showtime &show)
+    {
+        movieShowtimes[show.getMovie().getId()].push_back(show.getId());
+        theaterShowtimes[show.getTheater().getId()].push_back(show.getId());
+
+        int64_t start = startMinuteOf(show.getDate(), show.getTime());
+        if (start >= 0)
+            showtimesByStart.push_back(ShowStart{start, show.getId()});
+    }
+
+    // Merges the showtimes added since the last call into start order; call
+    // after a batch of addShowtime before querying by date.
+    void sortNewShowtimes()
+    {
+        auto byStart = [](const ShowStart &a, const ShowStart &b) { return a.minute < b.minute; };
+        auto firstNew = showtimesByStart.begin() + sortedStarts;
+        stable_sort(firstNew, showtimesByStart.end(), byStart);
+        inplace_merge(showtimesByStart.begin(), firstNew, showtimesByStart.end(), byStart);
+        sortedStarts = showtimesByStart.size();
+    }
+
+    // Movies whose title or director contains text, ignoring case, in id
+    // order. Queries of three or more characters only verify the movies
+    // that have every trigram of the query.
+    pmr::vector<MovieId> findMovies(string_view text, pmr::memory_resource *scratch = pmr::get_default_resource()) const
+    {
+        string query = lowercase(text);
+        pmr::vector<MovieId> matches(scratch);
+        if (query.size() < 3)
+        {
+            for (MovieId id = 0; id < searchText.size(); ++id)
+            {
+                if (searchText[id].find(query) != string::npos)
+                    matches.push_back(id);
+            }
+            return matches;
+        }
+
+        pmr::vector<const vector<MovieId> *> lists(scratch);
+        for (size_t pos = 0; pos + 3 <= query.size(); ++pos)
+        {
+            auto it = trigramPostings.find(trigramAt(query, pos));
+            if (it == trigramPostings.end())
+                return matches;
+            lists.push_back(&it->second);
+        }
+        sort(lists.begin(), lists.end(), [](const vector<MovieId> *a, const vector<MovieId> *b) { return a->size() < b->size(); });
+        lists.erase(unique(lists.begin(), lists.end()), lists.end());
+
+        pmr::vector<MovieId> candidates(lists.front()->begin(), lists.front()->end(), scratch);
+        pmr::vector<MovieId> narrowed(scratch);
+        narrowed.reserve(candidates.size());
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+        {
+            narrowed.clear();
+            set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(), back_inserter(narrowed));
+            candidates.swap(narrowed);
+        }
+        for (MovieId id : candidates)
+        {
+            if (searchText[id].find(query) != string::npos)
+                matches.push_back(id);
+        }
+        return matches;
+    }
+
+    span<const MovieId> findMoviesByGenre(string_view genre) const { return lookup(genrePostings, genre); }
+    span<const MovieId> findMoviesByLanguage(string_view language) const { return lookup(languagePostings, language); }
+    span<const ShowtimeId> getShowtimesOf(MovieId id) const { return movieShowtimes[id]; }
+
+    // Cities in the order their first theater was added.
+    span<const string> getCities(string_view state) const
+    {
+        auto it = stateCities.find(state);
+        return it == stateCities.end() ? span<const string>() : span<const string>(it->second);
+    }
+
+    span<const TheaterId> getTheatersIn(string_view city) const
+    {
+        auto it = cityTheaters.find(city);
+        return it == cityTheaters.end() ? span<const TheaterId>() : span<const TheaterId>(it->second);
+    }
+
+    span<const ShowtimeId> getShowtimesAt(TheaterId id) const { return theaterShowtimes[id]; }
+
+    // Showtimes starting in [fromMinute, toMinute), earliest first.
+    span<const ShowStart> getShowtimesBetween(int64_t fromMinute, int64_t toMinute) const
+    {
+        auto compare = [](const ShowStart &entry, int64_t minute) { return entry.minute < minute; };
+        auto first = lower_bound(showtimesByStart.begin(), showtimesByStart.end(), fromMinute, compare);
+        auto last = lower_bound(first, showtimesByStart.end(), max(fromMinute, toMinute), compare);
+        return span<const ShowStart>(first, last);
+    }
+};
+
+// The catalog as read from the data files, before it is added to an
+// engine. Shows refer to movies and theaters by position in these lists.
+struct CatalogData
+{
+    struct MovieEntry
+    {
+        string title;
+        string genre;
+        int duration;
+        string director;
+        string language;
+    };
+
+    struct TheaterEntry
+    {
+        string name;
+        string city;
+        string state;
+        int standardRows;
+        int premiumRows;
+        int seatsPerRow;
+        vector<MenuItem> menu; // empty: the shared or built-in menu
+    };
+
+    struct ShowEntry
+    {
+        uint32_t movie;
+        uint32_t theater;
+        string date;
+        string time;
+    };
+
+    vector<MovieEntry> movies;
+    vector<TheaterEntry> theaters;
+    vector<MenuItem> sharedMenu;
+    vector<ShowEntry> shows;
+    size_t errorCount = 0;
+};
+
+// Reads movies.txt, theaters.txt, menus.txt and schedule.txt from a data
+// directory. Each line is '|'-separated; blank lines and lines starting
+// with '#' are skipped, and invalid lines are reported and dropped:
+//   movies.txt    title|genre|minutes|director|language
+//   theaters.txt  name|city|state|standard rows|premium rows|seats per row
+//   menus.txt     theater name or *|item|price in Rs|category
+//   schedule.txt  theater name|movie title|YYYY-MM-DD|time
+// The schedule is split into chunks at line boundaries and parsed and
+// validated on several threads; results are kept in file order.
+class CatalogLoader
+{
+private:
+    using NameIndex = unordered_map<string, uint32_t, StringKeyHash, equal_to<>>;
+
+    struct Issue
+    {
+        size_t line; // 1-based, within the chunk it was found in
+        string message;
+    };
+
+    struct ScheduleChunk
+    {
+        string_view text;
+        size_t lineCount = 0;
+        vector<CatalogData::ShowEntry> shows;
+        vector<Issue> issues;
+    };
+
+    string directory;
+    unsigned threadCount;
+
+    string pathOf(const string &fileName) const
+    {
+        return directory.empty() ? fileName : (filesystem::path(directory) / fileName).string();
+    }
+
+    // Splits on '|' into at most N fields; returns the field count, or N + 1
+    // if there were more.
+    template <size_t N>
+    static size_t splitFields(string_view line, array<string_view, N> &fields)
+    {
+        size_t count = 0;
+        size_t pos = 0;
+        while (true)
+        {
+            size_t bar = line.find('|', pos);
+            if (count == N)
+                return N + 1;
+            fields[count++] = line.substr(pos, bar == string_view::npos ? string_view::npos : bar - pos);
+            if (bar == string_view::npos)
+                return count;
+            pos = bar + 1;
+        }
+    }
+
+    static bool parseCount(string_view text, int maximum, int &value)
+    {
+        int64_t number;
+        if (!parseWholeNumber(text, number) || number < 0 || number > maximum)
+            return false;
+        value = static_cast<int>(number);
+        return true;
+    }
+
+    // Calls handle(lineNumber, line) for every line that is not blank or a comment.
+    template <typename Handler>
+    static size_t forEachLine(string_view text, Handler &&handle)
+    {
+        size_t lineNumber = 0;
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            size_t end = min(text.find('\n', pos), text.size());
+            string_view line = text.substr(pos, end - pos);
+            pos = end + 1;
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (!line.empty() && line[0] != '#')
+                handle(lineNumber, line);
+        }
+        return lineNumber;
+    }
+
+    void report(const string &fileName, size_t line, const string &message, CatalogData &data) const
+    {
+        cerr << "[System Error] " << pathOf(fileName) << ":" << line << ": " << message << endl;
+        data.errorCount++;
+    }
+
+    static void parseSchedule(ScheduleChunk &chunk, const NameIndex &movieIndex, const NameIndex &theaterIndex)
+    {
+        chunk.lineCount = forEachLine(chunk.text, [&](size_t lineNumber, string_view line)
+        {
+            array<string_view, 4> fields;
+            chrono::sys_days day;
+            int minute;
+            if (splitFields(line, fields) != 4)
+            {
+                chunk.issues.push_back({lineNumber, "expected theater|movie|date|time"});
+                return;
+            }
+            auto theater = theaterIndex.find(fields[0]);
+            auto movie = movieIndex.find(fields[1]);
+            if (theater == theaterIndex.end())
+                chunk.issues.push_back({lineNumber, "unknown theater '" + string(fields[0]) + "'"});
+            else if (movie == movieIndex.end())
+                chunk.issues.push_back({lineNumber, "unknown movie '" + string(fields[1]) + "'"});
+            else if (!parseCalendarDate(fields[2], day) || !parseClockTime(fields[3], minute))
+                chunk.issues.push_back({lineNumber, "invalid date or time"});
+            else
+                chunk.shows.push_back({movie->second, theater->second, string(fields[2]), string(fields[3])});
+        });
+    }
+
+    void loadMovies(string_view text, CatalogData &data, NameIndex &movieIndex) const
+    {
+        forEachLine(text, [&](size_t lineNumber, string_view line)
+        {
+            array<string_view, 5> fields;
+            int duration;
+            if (splitFields(line, fields) != 5 || fields[0].empty() || !parseCount(fields[2], 24 * 60, duration))
+                report(MOVIES_FILE, lineNumber, "expected title|genre|minutes|director|language", data);
+            else if (!movieIndex.emplace(string(fields[0]), static_cast<uint32_t>(data.movies.size())).second)
+                report(MOVIES_FILE, lineNumber, "duplicate movie '" + string(fields[0]) + "'", data);
+            else
+                data.movies.push_back({string(fields[0]), string(fields[1]), duration, string(fields[3]), string(fields[4])});
+        });
+    }
+
+    void loadTheaters(string_view text, CatalogData &data, NameIndex &theaterIndex) const
+    {
+        forEachLine(text, [&](size_t lineNumber, string_view line)
+        {
+            array<string_view, 6> fields;
+            int standardRows, premiumRows, seatsPerRow;
+            if (splitFields(line, fields) != 6 || fields[0].empty() || !parseCount(fields[3], 26, standardRows) ||
+                !parseCount(fields[4], 26, premiumRows) || !parseCount(fields[5], 99, seatsPerRow) ||
+                standardRows + premiumRows == 0 || standardRows + premiumRows > 26 || seatsPerRow == 0)
+            {
+                report(THEATERS_FILE, lineNumber, "expected name|city|state|standard rows|premium rows|seats per row (up to 26 rows, 99 seats)", data);
+            }
+            else if (!theaterIndex.emplace(string(fields[0]), static_cast<uint32_t>(data.theaters.size())).second)
+                report(THEATERS_FILE, lineNumber, "duplicate theater '" + string(fields[0]) + "'", data);
+            else
+            {
+                data.theaters.push_back({string(fields[0]), string(fields[1]), string(fields[2]), standardRows,
+                                         premiumRows, seatsPerRow, {}});
+            }
+        });
+    }
+
+    void loadMenus(string_view text, CatalogData &data, const NameIndex &theaterIndex) const
+    {
+        forEachLine(text, [&](size_t lineNumber, string_view line)
+        {
+            array<string_view, 4> fields;
+            Money price;
+            if (splitFields(line, fields) != 4 || fields[1].empty() || !parseRupees(fields[2], price))
+            {
+                report(MENUS_FILE, lineNumber, "expected theater|item|price|category", data);
+                return;
+            }
+            MenuItem item(string(fields[1]), price, string(fields[3]));
+            auto theater = theaterIndex.find(fields[0]);
+            if (fields[0] == "*")
+                data.sharedMenu.push_back(move(item));
+            else if (theater != theaterIndex.end())
+                data.theaters[theater->second].menu.push_back(move(item));
+            else
+                report(MENUS_FILE, lineNumber, "unknown theater '" + string(fields[0]) + "'", data);
+        });
+    }
+
+public:
+    explicit CatalogLoader(const string &dataDirectory, unsigned threads = 0)
+        : directory(dataDirectory), threadCount(threads ? threads : max(1u, thread::hardware_concurrency())) {}
+
+    // False when there is no movies file, i.e. no catalog to load.
+    bool load(CatalogData &data) const
+    {
+        MappedFile moviesFile(pathOf(MOVIES_FILE));
+        if (!moviesFile.isOpen())
+            return false;
+        MappedFile theatersFile(pathOf(THEATERS_FILE));
+        MappedFile menusFile(pathOf(MENUS_FILE));
+        MappedFile scheduleFile(pathOf(SCHEDULE_FILE));
+
+        NameIndex movieIndex, theaterIndex;
+        loadMovies(string_view(moviesFile.data(), moviesFile.size()), data, movieIndex);
+        loadTheaters(string_view(theatersFile.data(), theatersFile.size()), data, theaterIndex);
+        loadMenus(string_view(menusFile.data(), menusFile.size()), data, theaterIndex);
+
+        // Chunks of at least CATALOG_CHUNK_BYTES, each ending after a newline.
+        string_view schedule(scheduleFile.data(), scheduleFile.size());
+        size_t workers = min<size_t>(threadCount, max<size_t>(1, schedule.size() / CATALOG_CHUNK_BYTES));
+        vector<ScheduleChunk> chunks(workers);
+        size_t begin = 0;
+        for (size_t w = 0; w < workers; ++w)
+        {
+            size_t end = (w + 1 == workers ? schedule.size() : schedule.size() * (w + 1) / workers);
+            end = min(schedule.find('\n', max(begin, end == 0 ? 0 : end - 1)), schedule.size());
+            end = min(end + 1, schedule.size());
+            chunks[w].text = schedule.substr(begin, end - begin);
+            begin = end;
+        }
+
+        vector<thread> pool;
+        for (size_t w = 0; w + 1 < workers; ++w)
+            pool.emplace_back(parseSchedule, ref(chunks[w]), cref(movieIndex), cref(theaterIndex));
+        parseSchedule(chunks.back(), movieIndex, theaterIndex);
+        for (thread &worker : pool)
+            worker.join();
+
+        size_t total = 0;
+        for (const ScheduleChunk &chunk : chunks)
+            total += chunk.shows.size();
+        data.shows.reserve(total);
+        size_t firstLine = 0;
+        for (ScheduleChunk &chunk : chunks)
+        {
+            for (const Issue &issue : chunk.issues)
+                report(SCHEDULE_FILE, firstLine + issue.line, issue.message, data);
+            move(chunk.shows.begin(), chunk.shows.end(), back_inserter(data.shows));
+            firstLine += chunk.lineCount;
+        }
+        return true;
+    }
+};
+
+// The booking records of the theaters whose id falls in one shard, with the
+// lock that guards them. Ids made here are nextSerial * BOOKING_SHARDS plus
+// the shard's index; journalSequence numbers the shard's journal records.
+struct BookingShard
+{
+    mutable mutex recordsMutex;
+    BookingStore bookings;
+    int nextSerial = static_cast<int>((FIRST_BOOKING_ID + BOOKING_SHARDS - 1) / BOOKING_SHARDS);
+    uint64_t journalSequence = 0;
+    string journalPayload; // reused for each record the shard journals
+};
+
+// Thread-safe booking core: owns the catalog, per-show seat inventories,
+// booking records and their persistence, independent of any console I/O.
+// Seat contention is resolved lock-free in SeatInventory. Booking records
+// are split by theater into BOOKING_SHARDS shards, each with its own lock,
+// so sessions at different theaters never wait on each other. A booking id
+// names its shard, so a cancel locks only that shard. Snapshots copy one
+// shard at a time under its lock and encode the copies with no lock held.
+class BookingEngine
+{
+private:
+    StableVector<Movie> movies;
+    StableVector<Theater> theaters;
+    StableVector<Showtime> showtimes;
+    CatalogIndex catalog;
+    BookingShard shards[BOOKING_SHARDS];
+    PricingEngine pricing;
+    vector<string> states;
+    string dataFile;
+    string journalFile;
+    string snapshotFile;
+    BookingJournal journal;
+    JournalWriter journalWriter;
+    atomic<uint64_t> journalBytes;  // queued since the last snapshot
+    atomic<uint64_t> snapshotBytes; // size of the last snapshot
+    mutex snapshotMutex;            // keeps each snapshot's ROTATE and SNAPSHOT in order
+    // Bookings only raise compactionDue; the compactor thread builds the
+    // snapshot, so no confirm or cancel ever waits for one.
+    atomic<bool> compactionDue;
+    atomic<bool> compactorRunning;
+    thread compactor;
+    atomic<uint32_t> nextSessionToken;
+    array<uint64_t, 4> sessionKeys; // round keys of the token permutation
+
+    // Sessions queue new holds by shard; the reaper thread swaps each queue's
+    // entries with its drained ones, moves them into the wheel and reclaims
+    // holds as they come due. Both vectors keep their capacity, so a steady
+    // stream of holds allocates nothing.
+    struct ExpiryQueue
+    {
+        mutex queueMutex;
+        vector<HoldExpiry> entries;
+        vector<HoldExpiry> draining; // only the reaper touches this
+    };
+    ExpiryQueue pendingExpiries[BOOKING_SHARDS];
+    HoldExpiryWheel holdWheel;
+    atomic<bool> reaperRunning;
+    thread holdReaper;
+    // Keys view each showtime's own id string, which never moves.
+    unordered_map<string_view, ShowtimeId, StringKeyHash> showtimeIndex;
+
+    // What decoding a snapshot needs about each of its showtimes, gathered
+    // once so shard threads never walk the catalog, and the totals of the
+    // bookings restored for it. Entries follow the snapshot's showtime order;
+    // liveId is the matching showtime in this catalog, or NO_LIVE_SHOW when
+    // the show is gone or its seats no longer line up. The snapshot stored
+    // each showtime's bookings in one shard, so no two threads write the
+    // same entry.
+    static const ShowtimeId NO_LIVE_SHOW = numeric_limits<ShowtimeId>::max();
+    struct RestoredShow
+    {
+        ShowtimeId liveId = NO_LIVE_SHOW;
+        bool fromText = false;
+        int capacity = 0;
+        int premiumCapacity = 0;
+        size_t shard = 0;
+        int bookings = 0;
+        int premiumSeats = 0;
+        int standardSeats = 0;
+        int64_t ticketPaise = 0;
+        int64_t foodPaise = 0;
+        int64_t discountPaise = 0;
+    };
+    // Restored bookings whose ids predate shard numbering and do not match
+    // their shard. Only written while loading, so lookups need no lock.
+    unordered_map<int, uint8_t> legacyShards;
+    int maxRestoredId;
+
+    static string dataPath(const string &directory, const string &fileName)
+    {
+        return directory.empty() ? fileName : (filesystem::path(directory) / fileName).string();
+    }
+
+    // Adds a showtime without restoring the index's start order; callers
+    // finish with catalog.sortNewShowtimes().
+    Showtime &appendShowtime(const Movie &movie, Theater &theater, const string &time, const string &date)
+    {
+        ShowtimeId id = static_cast<ShowtimeId>(showtimes.size());
+        Showtime &show = showtimes.emplace_back(id, movie, theater, time, date);
+        show.setPricing(pricing.compile(show));
+        showtimeIndex.emplace(show.getUniqueShowId(), id);
+        catalog.addShowtime(show);
+        theater.addShowtimeSlot();
+        return show;
+    }
+
+    Showtime *findShowtime(string_view uniqueShowId)
+    {
+        auto it = showtimeIndex.find(uniqueShowId);
+        return (it == showtimeIndex.end() ? nullptr : &showtimes[it->second]);
+    }
+
+    static size_t shardIndexOf(const Showtime &show)
+    {
+        return show.getTheater().getId() % BOOKING_SHARDS;
+    }
+
+    BookingShard &shardOf(const Showtime &show)
+    {
+        return shards[shardIndexOf(show)];
+    }
+
+    size_t shardOfBooking(int bookingId) const
+    {
+        if (!legacyShards.empty())
+        {
+            auto it = legacyShards.find(bookingId);
+            if (it != legacyShards.end())
+                return it->second;
+        }
+        return static_cast<uint32_t>(bookingId) % BOOKING_SHARDS;
+    }
+
+    // Caller holds the shard's lock.
+    int allocateBookingId(size_t shard)
+    {
+        return shards[shard].nextSerial++ * static_cast<int>(BOOKING_SHARDS) + static_cast<int>(shard);
+    }
+
+    // Load-time only: remembers ids that do not name their shard, and the
+    // highest id seen so new ids are allocated above it.
+    void noteRestoredId(int bookingId, size_t shard)
+    {
+        if (static_cast<uint32_t>(bookingId) % BOOKING_SHARDS != shard)
+            legacyShards[bookingId] = static_cast<uint8_t>(shard);
+        maxRestoredId = max(maxRestoredId, bookingId);
+    }
+
+    size_t countBookings() const
+    {
+        size_t count = 0;
+        for (const BookingShard &shard : shards)
+        {
+            count += shard.bookings.size();
+        }
+        return count;
+    }
+
+    // Adds the booking to its theater's shard; caller holds that shard's lock.
+    uint32_t addBooking(const Booking &booking, pmr::memory_resource *scratch = pmr::get_default_resource())
+    {
+        const Showtime &show = booking.getShowtime();
+        const vector<MenuItem> &menu = show.getTheater().getMenu();
+
+        pmr::vector<FoodLine> foodLines(scratch);
+        booking.getFoodOrder().forEachItem([&](string_view name, int quantity)
+        {
+            auto item = find_if(menu.begin(), menu.end(), [&](const MenuItem &m) { return m.getName() == name; });
+            if (item != menu.end())
+            {
+                foodLines.push_back({static_cast<uint16_t>(item - menu.begin()), static_cast<uint16_t>(quantity)});
+            }
+        });
+
+        BookingStore &store = shardOf(show).bookings;
+        uint32_t row = store.append(booking.getId(), booking.getShowtimeId(), booking.getSeatIndices(), foodLines,
+                                    static_cast<int32_t>(booking.getTicketTotal().getPaise()),
+                                    static_cast<int32_t>(booking.getFoodOrder().getTotalPrice().getPaise()),
+                                    static_cast<int32_t>(booking.getAppliedDiscount().getPaise()));
+        updateCounters(store, row, +1);
+        return row;
+    }
+
+    static BookingRecord getRecord(const BookingStore &store, uint32_t row)
+    {
+        BookingRecord record;
+        record.bookingId = store.getId(row);
+        record.showtimeId = store.getShowtimeId(row);
+        record.seats = store.getSeats(row);
+        record.food = store.getFood(row);
+        record.ticketPaise = store.getTicketPaise(row);
+        record.foodPaise = store.getFoodPaise(row);
+        record.discountPaise = store.getDiscountPaise(row);
+        return record;
+    }
+
+    bool isValidRecord(const BookingRecord &record) const
+    {
+        if (record.showtimeId >= showtimes.size())
+            return false;
+        int capacity = showtimes[record.showtimeId].getTheater().getCapacity();
+        return all_of(record.seats.begin(), record.seats.end(), [capacity](uint16_t seat) { return seat < capacity; });
+    }
+
+    // Adds a stored booking at its stored totals, booking its seats unless the
+    // caller has restored them already. A booking already present is skipped.
+    void restoreRecord(const BookingRecord &record, bool bookSeats)
+    {
+        Showtime &show = showtimes[record.showtimeId];
+        BookingStore &store = shardOf(show).bookings;
+        if (store.contains(record.bookingId))
+            return;
+        if (bookSeats)
+        {
+            SeatInventory &seats = show.getSeatInventory();
+            for (uint16_t seatIndex : record.seats)
+            {
+                int row, column;
+                if (seats.getLayout().getSeatPosition(seatIndex, row, column))
+                {
+                    seats.book(row, column);
+                }
+            }
+        }
+        uint32_t row = store.append(record.bookingId, record.showtimeId, record.seats, record.food,
+                                    record.ticketPaise, record.foodPaise, record.discountPaise);
+        updateCounters(store, row, +1);
+        noteRestoredId(record.bookingId, shardIndexOf(show));
+    }
+
+    int countPremiumSeats(const BookingStore &store, uint32_t row) const
+    {
+        int premiumCapacity = showtimes[store.getShowtimeId(row)].getTheater().getSeatLayout().getPremiumCapacity();
+        int premium = 0;
+        for (uint16_t seatIndex : store.getSeats(row))
+        {
+            premium += (seatIndex < premiumCapacity);
+        }
+        return premium;
+    }
+
+    void updateCounters(const BookingStore &store, uint32_t row, int sign)
+    {
+        Showtime &show = showtimes[store.getShowtimeId(row)];
+        int premium = countPremiumSeats(store, row);
+        int standard = static_cast<int>(store.getSeats(row).size()) - premium;
+        for (BookingCounters *counters : {&show.getCounters(), &show.getTheater().getCounters()})
+        {
+            counters->apply(sign, premium, standard, Money::fromPaise(store.getTicketPaise(row)),
+                            Money::fromPaise(store.getFoodPaise(row)), Money::fromPaise(store.getDiscountPaise(row)));
+        }
+    }
+
+    // Rebuilds the full Booking object for one stored row.
+    Booking materializeBooking(const BookingStore &store, uint32_t row)
+    {
+        Showtime &show = showtimes[store.getShowtimeId(row)];
+        const vector<MenuItem> &menu = show.getTheater().getMenu();
+
+        FoodOrder order;
+        for (const FoodLine &line : store.getFood(row))
+        {
+            if (line.itemId < menu.size())
+            {
+                order.addItem(menu[line.itemId], line.quantity);
+            }
+        }
+        return Booking(store.getId(row), show, store.getSeats(row), order, Money::fromPaise(store.getTicketPaise(row)),
+                       Money::fromPaise(store.getDiscountPaise(row)));
+    }
+
+    void initializeData()
+    {
+        addMovie("The AI Architect", "Sci-Fi/Action", 145, "James Cameron", "English");
+        addMovie("Eternal Sun", "Romantic Drama", 120, "Sofia Coppola", "Hindi");
+        addMovie("Rogue Agent 7", "Spy Thriller", 130, "Christopher Nolan", "English");
+        addMovie("Jungle Quest", "Family Animation", 95, "Pete Docter", "Hindi");
+        addMovie("Desert Storm", "War Epic", 160, "Ridley Scott", "English");
+        addMovie("The Last Voyage", "Mystery", 110, "Denis Villeneuve", "English");
+
+        addTheater("PVR Phoenix", "Mumbai", "Maharashtra", 6, 4, 10);
+        addTheater("Cinepolis Amanora", "Pune", "Maharashtra", 5, 5, 8);
+        addTheater("INOX Empress", "Nagpur", "Maharashtra", 7, 3, 12);
+
+        addTheater("Gopalan Cinemas", "Bangalore", "Karnataka", 5, 5, 10);
+        addTheater("PVR Orion Mall", "Mysore", "Karnataka", 4, 6, 9);
+
+        addTheater("Wave Cinemas", "New Delhi", "Delhi", 5, 5, 10);
+        addTheater("PVR Ambience", "Gurugram", "Delhi", 6, 4, 11);
+        addTheater("INOX Mall", "Noida", "Delhi", 7, 3, 9);
+
+        addTheater("Jazz Cinemas", "Chennai", "Tamil Nadu", 5, 5, 11);
+        addTheater("Brookfield Mall", "Coimbatore", "Tamil Nadu", 6, 4, 9);
+
+        addTheater("Inox South City", "Kolkata", "West Bengal", 7, 3, 10);
+        addTheater("PVR City Centre", "Siliguri", "West Bengal", 5, 5, 8);
+
+        addTheater("PVR Acropolis", "Ahmedabad", "Gujarat", 6, 4, 10);
+        addTheater("Cinepolis VR", "Surat", "Gujarat", 5, 5, 12);
+        addTheater("Inox Inorbit", "Vadodara", "Gujarat", 4, 6, 9);
+
+        addTheater("Wave Mall", "Lucknow", "Uttar Pradesh", 7, 3, 10);
+        addTheater("PVR Rave 3", "Kanpur", "Uttar Pradesh", 5, 5, 11);
+        addTheater("INOX Pacific", "Agra", "Uttar Pradesh", 6, 4, 8);
+
+        addShowtime(movies[0], theaters[0], "10:30 AM", "2025-12-15");
+        addShowtime(movies[1], theaters[0], "07:00 PM", "2025-12-15");
+        addShowtime(movies[4], theaters[1], "04:00 PM", "2025-12-15");
+        addShowtime(movies[5], theaters[1], "09:30 PM", "2025-12-15");
+        addShowtime(movies[5], theaters[2], "01:00 PM", "2025-12-16");
+
+        addShowtime(movies[2], theaters[3], "11:00 AM", "2025-12-16");
+        addShowtime(movies[0], theaters[3], "05:00 PM", "2025-12-16");
+        addShowtime(movies[1], theaters[4], "09:00 PM", "2025-12-16");
+        addShowtime(movies[3], theaters[4], "02:00 PM", "2025-12-16");
+
+        addShowtime(movies[3], theaters[5], "02:00 PM", "2025-12-17");
+        addShowtime(movies[5], theaters[6], "06:00 PM", "2025-12-17");
+        addShowtime(movies[4], theaters[7], "08:30 PM", "2025-12-17");
+        addShowtime(movies[1], theaters[7], "11:00 AM", "2025-12-17");
+
+        addShowtime(movies[1], theaters[8], "10:00 AM", "2025-12-18");
+        addShowtime(movies[0], theaters[8], "06:45 PM", "2025-12-18");
+        addShowtime(movies[2], theaters[9], "03:00 PM", "2025-12-18");
+
+        addShowtime(movies[0], theaters[10], "12:00 PM", "2025-12-19");
+        addShowtime(movies[3], theaters[11], "08:00 PM", "2025-12-19");
+
+        addShowtime(movies[5], theaters[12], "04:30 PM", "2025-12-20");
+        addShowtime(movies[2], theaters[13], "07:30 PM", "2025-12-20");
+        addShowtime(movies[4], theaters[14], "01:00 PM", "2025-12-20");
+
+        addShowtime(movies[0], theaters[15], "06:00 PM", "2025-12-21");
+        addShowtime(movies[1], theaters[16], "10:00 AM", "2025-12-21");
+        addShowtime(movies[3], theaters[17], "02:30 PM", "2025-12-21");
+    }
+
+    // One shard as it stood at one moment under its lock: its records, the
+    // booked words of its showtimes and the last journal sequence included.
+    struct ShardCapture
+    {
+        BookingStore bookings;
+        vector<uint64_t> words;
+        uint64_t journalSequence = 0;
+    };
+
+    // Copies each shard under its own lock in turn, then encodes the copies
+    // with no lock held. Shards are captured at different moments, but each
+    // copy's seats, records and sequence agree, which is all replay needs.
+    string buildSnapshot() const
+    {
+        size_t showCount;
+        array<vector<ShowtimeId>, BOOKING_SHARDS> shardShows;
+        array<ShardCapture, BOOKING_SHARDS> captures;
+        // A showtime added meanwhile may have bookings in a shard copied after
+        // it; start over so the snapshot includes its seats.
+        do
+        {
+            showCount = showtimes.size();
+            array<size_t, BOOKING_SHARDS> shardWords = {};
+            for (vector<ShowtimeId> &ids : shardShows)
+                ids.clear();
+            for (ShowtimeId id = 0; id < showCount; ++id)
+            {
+                size_t shard = shardIndexOf(showtimes[id]);
+                shardShows[shard].push_back(id);
+                shardWords[shard] += showtimes[id].getSeatInventory().getWordCount();
+            }
+            for (size_t shard = 0; shard < BOOKING_SHARDS; ++shard)
+            {
+                ShardCapture &capture = captures[shard];
+                capture.words.clear();
+                capture.words.reserve(shardWords[shard]);
+                lock_guard<mutex> lock(shards[shard].recordsMutex);
+                capture.bookings = shards[shard].bookings;
+                capture.journalSequence = shards[shard].journalSequence;
+                for (ShowtimeId id : shardShows[shard])
+                {
+                    const SeatInventory &seats = showtimes[id].getSeatInventory();
+                    for (size_t w = 0; w < seats.getWordCount(); ++w)
+                        capture.words.push_back(seats.getBookedWord(w));
+                }
+            }
+        } while (showtimes.size() != showCount);
+
+        SnapshotHeader header = {};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.showtimeCount = static_cast<uint32_t>(showCount);
+        header.shardCount = static_cast<uint32_t>(BOOKING_SHARDS);
+
+        vector<SnapshotShowtime> showSection(showCount);
+        array<SnapshotShard, BOOKING_SHARDS> shardSection = {};
+        string wordSection, recordSection;
+        BookingRecordCodec codec;
+        for (size_t shard = 0; shard < BOOKING_SHARDS; ++shard)
+        {
+            const ShardCapture &capture = captures[shard];
+            for (ShowtimeId id : shardShows[shard])
+            {
+                uint32_t wordCount = static_cast<uint32_t>(showtimes[id].getSeatInventory().getWordCount());
+                showSection[id] = {hashKey(showtimes[id].getUniqueShowId()), static_cast<uint32_t>(header.wordCount), wordCount};
+                header.wordCount += wordCount;
+            }
+            wordSection.append(reinterpret_cast<const char *>(capture.words.data()), capture.words.size() * sizeof(uint64_t));
+
+            const BookingStore &store = capture.bookings;
+            SnapshotShard &info = shardSection[shard];
+            info.journalSequence = capture.journalSequence;
+            size_t start = recordSection.size();
+            codec.reset();
+            for (uint32_t row = 0; row < store.getRowCount(); ++row)
+            {
+                if (store.isLive(row))
+                {
+                    codec.encode(getRecord(store, row), recordSection);
+                    info.bookingCount++;
+                    info.seatCount += store.getSeats(row).size();
+                    info.foodCount += store.getFood(row).size();
+                }
+            }
+            info.recordBytes = recordSection.size() - start;
+        }
+
+        string out;
+        out.reserve(sizeof(header) + sizeof(shardSection) + showCount * sizeof(SnapshotShowtime) + wordSection.size() +
+                    recordSection.size());
+        appendBytes(out, header);
+        appendBytes(out, shardSection);
+        out.append(reinterpret_cast<const char *>(showSection.data()), showSection.size() * sizeof(SnapshotShowtime));
+        out += wordSection;
+        out += recordSection;
+        return out;
+    }
+
+    // Decodes one shard's records of a snapshot into store and adds every
+    // booking's totals to its showtime's entry in shows, renumbering it to
+    // the live showtime. Bookings of shows with no live match are skipped and
+    // counted in dropped unless the text file restores them; those whose show
+    // now belongs to another shard are left in moved. Ids that do not name
+    // this shard are listed in foreignIds. False on any malformed record.
+    static bool decodeShard(const char *pos, const char *end, const SnapshotShard &info, size_t shard,
+                            vector<RestoredShow> &shows, BookingStore &store, vector<int> &foreignIds,
+                            BookingStore &moved, size_t &dropped)
+    {
+        BookingRecordCodec codec;
+        BookingRecord record;
+        store.reserve(info.bookingCount, info.seatCount, info.foodCount);
+        for (uint64_t i = 0; i < info.bookingCount; ++i)
+        {
+            if (!codec.decode(pos, end, record) || record.showtimeId >= shows.size())
+                return false;
+            RestoredShow &show = shows[record.showtimeId];
+            if (show.liveId == NO_LIVE_SHOW)
+            {
+                dropped += !show.fromText;
+                continue;
+            }
+            int premium = 0;
+            for (uint16_t seat : record.seats)
+            {
+                if (seat >= show.capacity)
+                    return false;
+                premium += (seat < show.premiumCapacity);
+            }
+            BookingStore &target = (show.shard == shard ? store : moved);
+            if (record.bookingId <= target.getLastId() && target.contains(record.bookingId))
+                return false;
+            target.append(record.bookingId, show.liveId, record.seats, record.food,
+                          record.ticketPaise, record.foodPaise, record.discountPaise);
+            if (show.shard == shard && static_cast<uint32_t>(record.bookingId) % BOOKING_SHARDS != shard)
+                foreignIds.push_back(record.bookingId);
+
+            show.bookings++;
+            show.premiumSeats += premium;
+            show.standardSeats += static_cast<int>(record.seats.size()) - premium;
+            show.ticketPaise += record.ticketPaise;
+            show.foodPaise += record.foodPaise;
+            show.discountPaise += record.discountPaise;
+        }
+        return pos == end;
+    }
+
+    // Restores from the binary snapshot. Every section is checked against
+    // the file size before it is read. Its showtimes are matched to the
+    // catalog by key hash, so a schedule that gained or lost shows since the
+    // snapshot was written still restores every show it kept. Shards are
+    // decoded in one pass each, in parallel, into fresh stores; nothing is
+    // touched until the whole file has proved valid. False means the caller
+    // should fall back to the text file. Shows whose seat layout changed are
+    // marked in textShows: their bookings are restored from the text file,
+    // which names seats rather than numbering them.
+    bool loadSnapshot(vector<bool> &textShows)
+    {
+        MappedFile file(snapshotFile);
+        if (!file.isOpen() || file.size() < sizeof(SnapshotHeader))
+        {
+            return false;
+        }
+
+        const char *data = file.data();
+        SnapshotHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+            header.shardCount != BOOKING_SHARDS)
+        {
+            return false;
+        }
+
+        // Each size is compared with what is left of the file before it is
+        // multiplied or added, so no header value can overflow an offset.
+        array<SnapshotShard, BOOKING_SHARDS> shardInfo;
+        size_t remaining = file.size() - sizeof(SnapshotHeader);
+        if (remaining < sizeof(shardInfo))
+            return false;
+        memcpy(shardInfo.data(), data + sizeof(SnapshotHeader), sizeof(shardInfo));
+        remaining -= sizeof(shardInfo);
+        size_t showOffset = sizeof(SnapshotHeader) + sizeof(shardInfo);
+
+        if (header.showtimeCount > remaining / sizeof(SnapshotShowtime))
+            return false;
+        size_t wordOffset = showOffset + header.showtimeCount * sizeof(SnapshotShowtime);
+        remaining -= header.showtimeCount * sizeof(SnapshotShowtime);
+
+        if (header.wordCount > remaining / sizeof(uint64_t))
+            return false;
+        size_t recordOffset = wordOffset + header.wordCount * sizeof(uint64_t);
+        remaining -= header.wordCount * sizeof(uint64_t);
+
+        // A record takes at least one byte per booking, seat and food line.
+        array<const char *, BOOKING_SHARDS + 1> shardRecords;
+        shardRecords[0] = data + recordOffset;
+        for (size_t shard = 0; shard < BOOKING_SHARDS; ++shard)
+        {
+            const SnapshotShard &info = shardInfo[shard];
+            if (info.recordBytes > remaining || info.bookingCount > info.recordBytes ||
+                info.seatCount > info.recordBytes || info.foodCount > info.recordBytes)
+            {
+                return false;
+            }
+            remaining -= info.recordBytes;
+            shardRecords[shard + 1] = shardRecords[shard] + info.recordBytes;
+        }
+        if (remaining != 0)
+            return false;
+
+        unordered_map<uint64_t, ShowtimeId> liveShows;
+        liveShows.reserve(showtimes.size());
+        for (const Showtime &show : showtimes)
+        {
+            liveShows.emplace(hashKey(show.getUniqueShowId()), show.getId());
+        }
+
+        vector<RestoredShow> shows(header.showtimeCount);
+        vector<bool> matched(showtimes.size(), false);
+        textShows.assign(showtimes.size(), false);
+        for (size_t i = 0; i < shows.size(); ++i)
+        {
+            SnapshotShowtime entry;
+            memcpy(&entry, data + showOffset + i * sizeof(entry), sizeof(entry));
+            if (entry.wordOffset + static_cast<uint64_t>(entry.wordCount) > header.wordCount)
+                return false;
+            auto live = liveShows.find(entry.keyHash);
+            if (live == liveShows.end() || matched[live->second])
+                continue;
+            const Showtime &show = showtimes[live->second];
+            matched[show.getId()] = true;
+            if (entry.wordCount != show.getSeatInventory().getWordCount())
+            {
+                textShows[show.getId()] = true;
+                shows[i].fromText = true;
+                continue;
+            }
+            const SeatLayout &layout = show.getTheater().getSeatLayout();
+            shows[i].liveId = show.getId();
+            shows[i].capacity = layout.getCapacity();
+            shows[i].premiumCapacity = layout.getPremiumCapacity();
+            shows[i].shard = shardIndexOf(show);
+        }
+
+        array<BookingStore, BOOKING_SHARDS> stores, moved;
+        array<vector<int>, BOOKING_SHARDS> foreignIds;
+        array<size_t, BOOKING_SHARDS> dropped = {};
+        array<bool, BOOKING_SHARDS> decoded = {};
+        size_t workers = min<size_t>(BOOKING_SHARDS, max(1u, thread::hardware_concurrency()));
+        auto decodeShards = [&](size_t worker)
+        {
+            for (size_t shard = worker; shard < BOOKING_SHARDS; shard += workers)
+            {
+                decoded[shard] = decodeShard(shardRecords[shard], shardRecords[shard + 1], shardInfo[shard], shard,
+                                             shows, stores[shard], foreignIds[shard], moved[shard], dropped[shard]);
+            }
+        };
+        vector<thread> pool;
+        for (size_t w = 1; w < workers; ++w)
+            pool.emplace_back(decodeShards, w);
+        decodeShards(0);
+        for (thread &worker : pool)
+            worker.join();
+        if (!all_of(decoded.begin(), decoded.end(), [](bool ok) { return ok; }))
+        {
+            return false;
+        }
+
+        size_t lost = accumulate(dropped.begin(), dropped.end(), size_t(0));
+        if (lost > 0)
+        {
+            cerr << "[System Error] " << lost << " bookings in " << snapshotFile
+                 << " are for showtimes no longer in the schedule and were not restored" << endl;
+        }
+
+        // Shows that moved to another shard since the snapshot was written
+        // (their theater was renumbered) join their new shard's store.
+        for (const BookingStore &from : moved)
+        {
+            for (uint32_t row = 0; row < from.getRowCount(); ++row)
+            {
+                int bookingId = from.getId(row);
+                size_t shard = shardIndexOf(showtimes[from.getShowtimeId(row)]);
+                if (stores[shard].contains(bookingId))
+                    return false;
+                stores[shard].append(bookingId, from.getShowtimeId(row), from.getSeats(row), from.getFood(row),
+                                     from.getTicketPaise(row), from.getFoodPaise(row), from.getDiscountPaise(row));
+                if (static_cast<uint32_t>(bookingId) % BOOKING_SHARDS != shard)
+                    foreignIds[shard].push_back(bookingId);
+            }
+        }
+
+        // The bitmaps already hold every booked seat.
+        for (size_t i = 0; i < shows.size(); ++i)
+        {
+            const RestoredShow &totals = shows[i];
+            if (totals.liveId == NO_LIVE_SHOW)
+                continue;
+            SnapshotShowtime entry;
+            memcpy(&entry, data + showOffset + i * sizeof(entry), sizeof(entry));
+            Showtime &show = showtimes[totals.liveId];
+            show.getSeatInventory().loadBookedWords(data + wordOffset + entry.wordOffset * sizeof(uint64_t), entry.wordCount);
+
+            if (totals.bookings == 0)
+                continue;
+            for (BookingCounters *counters : {&show.getCounters(), &show.getTheater().getCounters()})
+            {
+                counters->add(totals.bookings, totals.premiumSeats, totals.standardSeats, Money::fromPaise(totals.ticketPaise),
+                              Money::fromPaise(totals.foodPaise), Money::fromPaise(totals.discountPaise));
+            }
+        }
+        for (size_t shard = 0; shard < BOOKING_SHARDS; ++shard)
+        {
+            shards[shard].journalSequence = shardInfo[shard].journalSequence;
+            shards[shard].bookings = std::move(stores[shard]);
+            maxRestoredId = max(maxRestoredId, shards[shard].bookings.getLastId());
+            for (int bookingId : foreignIds[shard])
+            {
+                noteRestoredId(bookingId, shard);
+            }
+        }
+        snapshotBytes = file.size();
+        return true;
+    }
+
+    // Compacts the journal: rotates it, then queues a binary snapshot of
+    // every live booking. The writer swaps the snapshot in and deletes the
+    // retired journal; records made while the snapshot was built are in the
+    // new journal, so none are lost. Returns the snapshot's sequence number.
+    uint64_t writeSnapshot()
+    {
+        lock_guard<mutex> lock(snapshotMutex);
+        journalBytes.store(0);
+        journalWriter.push(JournalWriter::Kind::ROTATE, string());
+        string snapshot = buildSnapshot();
+        snapshotBytes.store(snapshot.size());
+        return journalWriter.push(JournalWriter::Kind::SNAPSHOT, move(snapshot));
+    }
+
+    // Human-readable copy of the live bookings in the original text format.
+    void exportBookingData() const
+    {
+        string contents;
+        for (const BookingShard &shard : shards)
+        {
+            lock_guard<mutex> lock(shard.recordsMutex);
+            const BookingStore &store = shard.bookings;
+            for (uint32_t row = 0; row < store.getRowCount(); ++row)
+            {
+                if (!store.isLive(row))
+                    continue;
+                const Showtime &show = showtimes[store.getShowtimeId(row)];
+                const SeatLayout &layout = show.getTheater().getSeatLayout();
+                contents += to_string(store.getId(row));
+                contents += '|';
+                contents += show.getUniqueShowId();
+                contents += '|';
+                span<const uint16_t> seatIndices = store.getSeats(row);
+                for (size_t i = 0; i < seatIndices.size(); ++i)
+                {
+                    if (i)
+                        contents += ',';
+                    contents += layout.getSeatId(seatIndices[i]);
+                }
+                contents += '\n';
+            }
+        }
+        if (!writeFileAtomically(dataFile, contents))
+        {
+            cerr << "\n[System Error] Unable to save booking data to file: " << dataFile << endl;
+        }
+    }
+
+    // Queue a journal record. Caller holds the shard's lock, which keeps its
+    // sequence numbers in order.
+    void journalBooking(size_t shard, uint32_t row)
+    {
+        const BookingStore &store = shards[shard].bookings;
+        const string &showKey = showtimes[store.getShowtimeId(row)].getUniqueShowId();
+        string &payload = shards[shard].journalPayload;
+        payload.clear();
+        payload.reserve(JOURNAL_SLOT_BYTES);
+        BookingJournal::appendRecordHeader(payload, shard, ++shards[shard].journalSequence);
+        appendVarint(payload, showKey.size());
+        payload += showKey;
+        BookingRecordCodec().encode(getRecord(store, row), payload);
+        queueJournalRecord(JOURNAL_CREATED, payload);
+    }
+
+    void journalCancellation(size_t shard, int bookingId)
+    {
+        string &payload = shards[shard].journalPayload;
+        payload.clear();
+        BookingJournal::appendRecordHeader(payload, shard, ++shards[shard].journalSequence);
+        appendVarint(payload, static_cast<uint64_t>(bookingId));
+        queueJournalRecord(JOURNAL_CANCELLED, payload);
+    }
+
+    void queueJournalRecord(char kind, string_view payload)
+    {
+        size_t bytes = 0;
+        journalWriter.pushRecord([&](string &out)
+        {
+            BookingJournal::appendRecord(out, kind, payload);
+            bytes = out.size();
+        });
+        noteJournalBytes(bytes);
+    }
+
+    // Wakes the compactor once the journal has grown to JOURNAL_COMPACT_PERCENT
+    // of the last snapshot, so replay stays a fraction of the snapshot load
+    // and a large store is not rewritten every few thousand bookings.
+    void noteJournalBytes(size_t bytes)
+    {
+        uint64_t queued = journalBytes.fetch_add(bytes) + bytes;
+        uint64_t limit = max<uint64_t>(JOURNAL_COMPACT_MIN_BYTES, snapshotBytes.load() / 100 * JOURNAL_COMPACT_PERCENT);
+        if (queued >= limit && !compactionDue.exchange(true))
+        {
+            compactionDue.notify_one();
+        }
+    }
+
+    void runCompactor()
+    {
+        while (compactorRunning.load())
+        {
+            compactionDue.wait(false);
+            if (!compactorRunning.load())
+                break;
+            writeSnapshot();
+            compactionDue.store(false);
+        }
+    }
+
+    bool hasBooking(int bookingId) const
+    {
+        return shards[shardOfBooking(bookingId)].bookings.contains(bookingId);
+    }
+
+    // Parses one "id|show key|seats" record. Records already present are
+    // skipped so replaying a journal over a newer snapshot is harmless, as
+    // are records for shows not marked in onlyShows when it is given.
+    bool restoreBooking(const string &line, const vector<bool> *onlyShows = nullptr)
+    {
+        // The show key itself contains '|', so split on the first and last one.
+        size_t idEnd = line.find('|');
+        size_t seatsBegin = line.rfind('|');
+
+        if (idEnd == string::npos || seatsBegin <= idEnd)
+        {
+            return false;
+        }
+
+        try
+        {
+            int bookingId = stoi(line.substr(0, idEnd));
+            string_view uniqueShowId(line.data() + idEnd + 1, seatsBegin - idEnd - 1);
+            string_view seatsString(line.data() + seatsBegin + 1, line.size() - seatsBegin - 1);
+
+            if (bookingId <= 0)
+            {
+                return false;
+            }
+            if (hasBooking(bookingId))
+            {
+                return true;
+            }
+
+            Showtime *foundShowtime = findShowtime(uniqueShowId);
+            if (!foundShowtime)
+            {
+                return false;
+            }
+            if (onlyShows && !(*onlyShows)[foundShowtime->getId()])
+            {
+                return true;
+            }
+
+            // Text records carry no totals. They are billed at the theater's
+            // base seat prices, as they were when this format was written, so
+            // the totals do not follow the current pricing rules.
+            vector<uint16_t> bookedSeats;
+            Money tickets;
+            const Theater &theater = foundShowtime->getTheater();
+            SeatInventory &seats = foundShowtime->getSeatInventory();
+            const SeatLayout &layout = seats.getLayout();
+            while (!seatsString.empty())
+            {
+                size_t comma = seatsString.find(',');
+                string_view seatId = seatsString.substr(0, comma);
+                seatsString = (comma == string_view::npos ? string_view() : seatsString.substr(comma + 1));
+
+                int row, column;
+                if (layout.findSeat(seatId, row, column))
+                {
+                    seats.book(row, column);
+                    bookedSeats.push_back(static_cast<uint16_t>(layout.getSeatIndex(row, column)));
+                    tickets += theater.getTicketPrice(layout.getRowType(row));
+                }
+            }
+
+            addBooking(Booking(bookingId, *foundShowtime, bookedSeats, FoodOrder(), tickets, Money()));
+            noteRestoredId(bookingId, shardIndexOf(*foundShowtime));
+            return true;
+        }
+        catch (const std::exception &e)
+        {
+            cerr << "[System Error] Error processing booking line: " << line << " (" << e.what() << ")" << endl;
+            return false;
+        }
+    }
+
+    // One JOURNAL_CREATED payload after its shard and sequence: the show
+    // key, then the booking record.
+    void restoreJournalBooking(string_view payload, BookingRecordCodec &codec)
+    {
+        const char *pos = payload.data();
+        const char *end = pos + payload.size();
+        uint64_t keyLength;
+        BookingRecord record;
+        codec.reset();
+        if (readVarint(pos, end, keyLength) && keyLength <= static_cast<uint64_t>(end - pos))
+        {
+            Showtime *show = findShowtime(string_view(pos, keyLength));
+            pos += keyLength;
+            if (show && codec.decode(pos, end, record) && pos == end)
+            {
+                record.showtimeId = show->getId();
+                if (isValidRecord(record))
+                {
+                    restoreRecord(record, true);
+                    return;
+                }
+            }
+        }
+        cerr << "[System Error] Skipping unreadable journal record in " << journalFile << endl;
+    }
+
+    bool removeBooking(BookingStore &store, int bookingId)
+    {
+        long row = store.findRow(bookingId);
+        if (row < 0)
+        {
+            return false;
+        }
+
+        SeatInventory &seats = showtimes[store.getShowtimeId(row)].getSeatInventory();
+        for (uint16_t seatIndex : store.getSeats(row))
+        {
+            int seatRow, column;
+            if (seats.getLayout().getSeatPosition(seatIndex, seatRow, column))
+            {
+                seats.release(seatRow, column);
+            }
+        }
+        updateCounters(store, row, -1);
+        store.erase(row);
+        return true;
+    }
+
+    // Load-time only: does not lock.
+    bool removeBooking(int bookingId)
+    {
+        return removeBooking(shards[shardOfBooking(bookingId)].bookings, bookingId);
+    }
+
+    void importBookingData(const vector<bool> *onlyShows = nullptr)
+    {
+        ifstream inFile(dataFile);
+        string line;
+        if (inFile.is_open())
+        {
+            while (getline(inFile, line))
+            {
+                restoreBooking(line, onlyShows);
+            }
+            inFile.close();
+        }
+    }
+
+public:
+    // Restores the snapshot (or the text export) and replays the journal.
+    // A numbered record at or below the sequence the snapshot covers for its
+    // shard is already in the snapshot and is skipped, so a crash between
+    // writing a snapshot and truncating the journal replays nothing twice.
+    // Unnumbered records predate every snapshot this version writes, so they
+    // are only replayed over the text export.
+    // Must run once, after the catalog is complete and before any session.
+    void loadBookingData()
+    {
+        vector<bool> textShows;
+        bool fromSnapshot = loadSnapshot(textShows);
+        if (!fromSnapshot)
+        {
+            importBookingData();
+        }
+        else if (find(textShows.begin(), textShows.end(), true) != textShows.end())
+        {
+            importBookingData(&textShows);
+        }
+
+        BookingRecordCodec codec;
+        journal.readRecords([&](char kind, string_view payload)
+        {
+            size_t shard = 0;
+            uint64_t sequence, value;
+            if (kind == JOURNAL_CREATED || kind == JOURNAL_CANCELLED)
+            {
+                if (!BookingJournal::readRecordHeader(payload, shard, sequence) || shard >= BOOKING_SHARDS)
+                {
+                    cerr << "[System Error] Skipping unreadable journal record in " << journalFile << endl;
+                    return;
+                }
+                if (sequence <= shards[shard].journalSequence)
+                    return;
+                shards[shard].journalSequence = sequence;
+            }
+            else if (fromSnapshot)
+            {
+                return;
+            }
+
+            const char *pos = payload.data();
+            const char *end = pos + payload.size();
+            if (kind == JOURNAL_CREATED || kind == JOURNAL_CREATED_V1)
+            {
+                restoreJournalBooking(payload, codec);
+            }
+            else if (kind == JOURNAL_CANCELLED)
+            {
+                if (readVarint(pos, end, value))
+                    removeBooking(shards[shard].bookings, static_cast<int>(value));
+            }
+            else if (kind == JOURNAL_CANCELLED_V1)
+            {
+                if (readVarint(pos, end, value))
+                    removeBooking(static_cast<int>(value));
+            }
+            else if (kind == 'B')
+            {
+                restoreBooking(string(payload));
+            }
+            else if (kind == 'C')
+            {
+                int64_t bookingId;
+                if (parseWholeNumber(payload, bookingId))
+                    removeBooking(static_cast<int>(bookingId));
+            }
+        });
+
+        int firstSerial = (max(maxRestoredId + 1, FIRST_BOOKING_ID) + static_cast<int>(BOOKING_SHARDS) - 1) / static_cast<int>(BOOKING_SHARDS);
+        for (BookingShard &shard : shards)
+        {
+            shard.nextSerial = max(shard.nextSerial, firstSerial);
+        }
+
+        journalBytes = journal.getRecordBytes();
+        noteJournalBytes(0);
+        if (!journal.open())
+        {
+            cerr << "\n[System Error] Unable to open booking journal: " << journalFile << endl;
+        }
+    }
+
+private:
+    // Four Feistel rounds over the two 16-bit halves.
+    uint32_t permuteToken(uint32_t counter) const
+    {
+        uint32_t left = counter >> 16;
+        uint32_t right = counter & 0xFFFF;
+        for (uint64_t key : sessionKeys)
+        {
+            uint64_t mixed = (right ^ key) * 0x9E3779B97F4A7C15ULL;
+            mixed ^= mixed >> 29;
+            mixed *= 0xBF58476D1CE4E5B9ULL;
+            uint32_t next = left ^ static_cast<uint32_t>(mixed >> 48);
+            left = right;
+            right = next;
+        }
+        return (left << 16) | right;
+    }
+
+    void scheduleExpiry(size_t shard, const HoldExpiry &expiry)
+    {
+        ExpiryQueue &queue = pendingExpiries[shard];
+        lock_guard<mutex> lock(queue.queueMutex);
+        queue.entries.push_back(expiry);
+    }
+
+    void expireHolds(const vector<HoldExpiry> &due, uint32_t nowTick)
+    {
+        for (const HoldExpiry &entry : due)
+        {
+            Showtime *show = getShowtime(entry.showtimeId);
+            if (!show)
+                continue;
+            SeatInventory &seats = show->getSeatInventory();
+            for (uint16_t seatIndex : entry.getSeats())
+            {
+                int row, column;
+                if (seats.getLayout().getSeatPosition(seatIndex, row, column))
+                {
+                    seats.expireHold(row, column, entry.token, nowTick);
+                }
+            }
+        }
+    }
+
+    void runHoldReaper()
+    {
+        vector<HoldExpiry> due;
+        while (reaperRunning.load())
+        {
+            this_thread::sleep_for(chrono::milliseconds(1000 / HOLD_TICKS_PER_SECOND));
+
+            for (ExpiryQueue &queue : pendingExpiries)
+            {
+                {
+                    lock_guard<mutex> lock(queue.queueMutex);
+                    queue.draining.swap(queue.entries);
+                }
+                for (HoldExpiry &entry : queue.draining)
+                {
+                    holdWheel.schedule(move(entry), due);
+                }
+                queue.draining.clear();
+            }
+
+            uint32_t now = currentHoldTick();
+            holdWheel.advance(now, due);
+            expireHolds(due, now);
+            due.clear();
+        }
+    }
+
+    // Resolves seat indices for a show, sorted with duplicates dropped so
+    // that overlapping requests always contend for their lowest common seat
+    // first.
+    bool resolveSeats(ShowtimeId showId, span<const int> seatIndices, Showtime *&show, pmr::vector<pair<int, int>> &positions)
+    {
+        show = getShowtime(showId);
+        if (!show || seatIndices.empty())
+            return false;
+
+        const SeatLayout &layout = show->getTheater().getSeatLayout();
+        positions.clear();
+        positions.reserve(seatIndices.size());
+        for (int seatIndex : seatIndices)
+        {
+            int row, column;
+            if (!layout.getSeatPosition(seatIndex, row, column))
+                return false;
+            positions.emplace_back(row, column);
+        }
+        sort(positions.begin(), positions.end());
+        positions.erase(unique(positions.begin(), positions.end()), positions.end());
+        return true;
+    }
+
+public:
+    // Keeps its files in dataDirectory. The catalog comes from the catalog
+    // files there, or the built-in one if there are none. Without the
+    // default catalog the caller adds movies, theaters and showtimes (or
+    // calls loadCatalog), then calls loadBookingData().
+    explicit BookingEngine(const string &dataDirectory = "", bool defaultCatalog = true)
+        : dataFile(dataPath(dataDirectory, BOOKING_DATA_FILE)),
+          journalFile(dataPath(dataDirectory, BOOKING_JOURNAL_FILE)),
+          snapshotFile(dataPath(dataDirectory, BOOKING_SNAPSHOT_FILE)),
+          journal(journalFile), journalWriter(journal, snapshotFile), journalBytes(0), snapshotBytes(0), compactionDue(false),
+          compactorRunning(true), nextSessionToken(1),
+          holdWheel(currentHoldTick()), reaperRunning(true), maxRestoredId(0)
+    {
+        random_device entropy;
+        for (uint64_t &key : sessionKeys)
+        {
+            key = (uint64_t(entropy()) << 32) | entropy();
+        }
+        pricing.loadRules(dataPath(dataDirectory, PRICING_RULES_FILE));
+        if (defaultCatalog)
+        {
+            {
+                StageTimer timer(Stage::CATALOG_LOAD);
+                if (!loadCatalog(dataDirectory))
+                    initializeData();
+            }
+            StageTimer timer(Stage::BOOKINGS_LOAD);
+            loadBookingData();
+        }
+        holdReaper = thread(&BookingEngine::runHoldReaper, this);
+        compactor = thread(&BookingEngine::runCompactor, this);
+    }
+
+    ~BookingEngine()
+    {
+        reaperRunning.store(false);
+        holdReaper.join();
+        compactorRunning.store(false);
+        compactionDue.store(true);
+        compactionDue.notify_one();
+        compactor.join();
+
+        StageTimer timer(Stage::SAVE_BOOKINGS);
+        writeSnapshot();
+        exportBookingData();
+        journalWriter.stop();
+    }
+
+    BookingEngine(const BookingEngine &) = delete;
+    BookingEngine &operator=(const BookingEngine &) = delete;
+
+    // Catalog entries never move, so showtimes and bookings can keep
+    // referring to them by address while more are added. Additions come
+    // from one thread at a time; booking threads may run meanwhile.
+    Movie &addMovie(const string &title, const string &genre, int duration, const string &director, const string &language)
+    {
+        Movie &movie = movies.emplace_back(static_cast<MovieId>(movies.size()), title, genre, duration, director, language);
+        catalog.addMovie(movie);
+        return movie;
+    }
+
+    Theater &addTheater(const string &name, const string &city, const string &state, int stdRows, int premRows, int seatsPer)
+    {
+        Theater &theater = theaters.emplace_back(static_cast<TheaterId>(theaters.size()), name, city, state, stdRows, premRows, seatsPer);
+        if (catalog.getCities(state).empty())
+            states.push_back(state);
+        catalog.addTheater(theater);
+        return theater;
+    }
+
+    Showtime &addShowtime(const Movie &movie, Theater &theater, const string &time, const string &date)
+    {
+        Showtime &show = appendShowtime(movie, theater, time, date);
+        catalog.sortNewShowtimes();
+        return show;
+    }
+
+    // Adds the movies, theaters and schedule from the catalog files in
+    // directory. Returns false, adding nothing, when there are none.
+    bool loadCatalog(const string &directory)
+    {
+        CatalogData data;
+        if (!CatalogLoader(directory).load(data))
+            return false;
+
+        vector<Movie *> loadedMovies;
+        for (const CatalogData::MovieEntry &entry : data.movies)
+            loadedMovies.push_back(&addMovie(entry.title, entry.genre, entry.duration, entry.director, entry.language));
+
+        vector<Theater *> loadedTheaters;
+        for (CatalogData::TheaterEntry &entry : data.theaters)
+        {
+            Theater &theater = addTheater(entry.name, entry.city, entry.state, entry.standardRows, entry.premiumRows, entry.seatsPerRow);
+            if (!entry.menu.empty())
+                theater.setMenu(move(entry.menu));
+            else if (!data.sharedMenu.empty())
+                theater.setMenu(data.sharedMenu);
+            loadedTheaters.push_back(&theater);
+        }
+
+        showtimeIndex.reserve(showtimes.size() + data.shows.size());
+        string key;
+        for (const CatalogData::ShowEntry &entry : data.shows)
+        {
+            const Movie &movie = *loadedMovies[entry.movie];
+            Theater &theater = *loadedTheaters[entry.theater];
+            key.assign(theater.getName()).append("|").append(entry.date).append("|").append(entry.time).append("|").append(movie.getTitle());
+            if (findShowtime(key))
+                cerr << "[System Error] Duplicate showtime in " << SCHEDULE_FILE << ": " << key << endl;
+            else
+                appendShowtime(movie, theater, entry.time, entry.date);
+        }
+        catalog.sortNewShowtimes();
+        return true;
+    }
+
+    // Replaces the pricing rules and recompiles every showtime. Bookings
+    // already made keep their totals.
+    void setPricingRules(vector<PricingRule> rules)
+    {
+        pricing.setRules(move(rules));
+        for (Showtime &show : showtimes)
+        {
+            show.setPricing(pricing.compile(show));
+        }
+    }
+
+    const vector<PricingRule> &getPricingRules() const { return pricing.getRules(); }
+
+    const vector<string> &getStates() const { return states; }
+    const CatalogIndex &getCatalog() const { return catalog; }
+    const StableVector<Movie> &getMovies() const { return movies; }
+    StableVector<Theater> &getTheaters() { return theaters; }
+    StableVector<Showtime> &getShowtimes() { return showtimes; }
+
+    Showtime *getShowtime(ShowtimeId id)
+    {
+        return (id < showtimes.size() ? &showtimes[id] : nullptr);
+    }
+
+    // Each shard is copied under its own lock, so the list is not one
+    // instant across shards.
+    vector<Booking> listBookings()
+    {
+        vector<Booking> bookings;
+        for (BookingShard &shard : shards)
+        {
+            lock_guard<mutex> lock(shard.recordsMutex);
+            for (uint32_t row = 0; row < shard.bookings.getRowCount(); ++row)
+            {
+                if (shard.bookings.isLive(row))
+                    bookings.push_back(materializeBooking(shard.bookings, row));
+            }
+        }
+        return bookings;
+    }
+
+    BookingColumns captureColumns() const
+    {
+        BookingColumns columns;
+        for (const BookingShard &shard : shards)
+        {
+            lock_guard<mutex> lock(shard.recordsMutex);
+            for (uint32_t row = 0; row < shard.bookings.getRowCount(); ++row)
+            {
+                if (shard.bookings.isLive(row))
+                    columns.append(shard.bookings, row, countPremiumSeats(shard.bookings, row));
+            }
+        }
+        return columns;
+    }
+
+    bool bookingExists(int bookingId) const
+    {
+        const BookingShard &shard = shards[shardOfBooking(bookingId)];
+        lock_guard<mutex> lock(shard.recordsMutex);
+        return shard.bookings.contains(bookingId);
+    }
+
+    // Each client session gets its own token; seat holds are tagged with it.
+    // Tokens are a session counter run through a permutation of 32-bit
+    // values keyed at startup, so they never repeat while the counter does
+    // not wrap, yet one client cannot work out another's from its own.
+    uint32_t openSession()
+    {
+        uint32_t token;
+        do
+        {
+            token = permuteToken(nextSessionToken.fetch_add(1));
+        } while (token == 0);
+        return token;
+    }
+
+    // Holds every requested seat for the session or none of them.
+    bool holdSeats(ShowtimeId showId, span<const int> seatIndices, uint32_t token, int holdSeconds = SEAT_HOLD_SECONDS,
+                   pmr::memory_resource *scratch = pmr::get_default_resource())
+    {
+        StageTimer timer(Stage::SEAT_HOLD);
+        Showtime *show;
+        pmr::vector<pair<int, int>> positions(scratch);
+        if (!resolveSeats(showId, seatIndices, show, positions))
+            return false;
+
+        SeatInventory &seats = show->getSeatInventory();
+        uint32_t now = currentHoldTick();
+        uint32_t expiry = now + static_cast<uint32_t>(max(holdSeconds, 1)) * HOLD_TICKS_PER_SECOND;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            if (!seats.tryHold(positions[i].first, positions[i].second, token, expiry, now))
+            {
+                for (size_t k = 0; k < i; ++k)
+                {
+                    seats.releaseHold(positions[k].first, positions[k].second, token);
+                }
+                return false;
+            }
+        }
+
+        size_t shard = shardIndexOf(*show);
+        HoldExpiry entry{showId, token, expiry, 0, {}};
+        for (const auto &position : positions)
+        {
+            if (entry.seatCount == HoldExpiry::MAX_SEATS)
+            {
+                scheduleExpiry(shard, entry);
+                entry.seatCount = 0;
+            }
+            entry.seatIndices[entry.seatCount++] = static_cast<uint16_t>(seats.getLayout().getSeatIndex(position.first, position.second));
+        }
+        scheduleExpiry(shard, entry);
+        return true;
+    }
+
+    // Holds the most central block of count adjacent seats of the given
+    // class. Retries with the next best block if another session wins a seat
+    // first. Returns the held seat indices, or nothing if no block is free.
+    pmr::vector<int> holdBestSeats(ShowtimeId showId, int count, Seat::Type type, uint32_t token, int holdSeconds = SEAT_HOLD_SECONDS,
+                                   pmr::memory_resource *scratch = pmr::get_default_resource())
+    {
+        pmr::vector<int> block(scratch);
+        Showtime *show = getShowtime(showId);
+        if (!show)
+            return block;
+
+        SeatInventory &seats = show->getSeatInventory();
+        const SeatLayout &layout = seats.getLayout();
+        for (int attempt = 0; attempt < BEST_SEAT_ATTEMPTS; ++attempt)
+        {
+            int row, column;
+            if (!seats.findBestBlock(count, type, row, column))
+                break;
+
+            block.clear();
+            for (int i = 0; i < count; ++i)
+            {
+                block.push_back(layout.getSeatIndex(row, column + i));
+            }
+            if (holdSeats(showId, block, token, holdSeconds, scratch))
+                return block;
+        }
+        block.clear();
+        return block;
+    }
+
+    void releaseSeats(ShowtimeId showId, span<const int> seatIndices, uint32_t token,
+                      pmr::memory_resource *scratch = pmr::get_default_resource())
+    {
+        Showtime *show;
+        pmr::vector<pair<int, int>> positions(scratch);
+        if (!resolveSeats(showId, seatIndices, show, positions))
+            return;
+
+        SeatInventory &seats = show->getSeatInventory();
+        for (const auto &position : positions)
+        {
+            seats.releaseHold(position.first, position.second, token);
+        }
+    }
+
+    // Turns the session's live holds into a booking, all-or-nothing. Fails
+    // without side effects if any hold has expired or belongs to someone else.
+    optional<Booking> confirmBooking(ShowtimeId showId, span<const int> seatIndices, uint32_t token, const FoodOrder &order,
+                                     string_view promoCode = {}, pmr::memory_resource *scratch = pmr::get_default_resource())
+    {
+        StageTimer timer(Stage::BOOKING_CONFIRM);
+        Showtime *show;
+        pmr::vector<pair<int, int>> positions(scratch);
+        if (!resolveSeats(showId, seatIndices, show, positions))
+            return nullopt;
+
+        SeatInventory &seats = show->getSeatInventory();
+        uint32_t now = currentHoldTick();
+        pmr::vector<uint64_t> pinnedTags(positions.size(), scratch);
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            if (!seats.pinHold(positions[i].first, positions[i].second, token, now, pinnedTags[i]))
+            {
+                for (size_t k = 0; k < i; ++k)
+                {
+                    seats.unpinHold(positions[k].first, positions[k].second, pinnedTags[k]);
+                }
+                return nullopt;
+            }
+        }
+
+        const SeatLayout &layout = seats.getLayout();
+        pmr::vector<uint16_t> seatList(scratch);
+        seatList.reserve(positions.size());
+        for (const auto &position : positions)
+        {
+            seatList.push_back(static_cast<uint16_t>(layout.getSeatIndex(position.first, position.second)));
+        }
+
+        // Seats are booked and the id allocated under the shard lock, so ids
+        // reach the store in order and the shard's seats match its records
+        // whenever the lock is free.
+        size_t shardIndex = shardIndexOf(*show);
+        BookingShard &shard = shards[shardIndex];
+        optional<Booking> booking;
+        {
+            lock_guard<mutex> lock(shard.recordsMutex);
+            for (const auto &position : positions)
+            {
+                seats.bookPinnedHold(position.first, position.second);
+            }
+            uint64_t constructStart = TickClock::now();
+            booking.emplace(allocateBookingId(shardIndex), *show, seatList, order, promoCode, scratch);
+            StageMetrics::instance().record(Stage::BOOKING_CONSTRUCT, TickClock::now() - constructStart);
+            journalBooking(shardIndex, addBooking(*booking, scratch));
+        }
+        return booking;
+    }
+
+    bool cancelBooking(int bookingId)
+    {
+        StageTimer timer(Stage::BOOKING_CANCEL);
+        if (bookingId <= 0)
+            return false;
+        size_t shardIndex = shardOfBooking(bookingId);
+        BookingShard &shard = shards[shardIndex];
+        lock_guard<mutex> lock(shard.recordsMutex);
+        if (!removeBooking(shard.bookings, bookingId))
+            return false;
+        journalCancellation(shardIndex, bookingId);
+        return true;
+    }
+
+    // Queues a snapshot and returns without waiting for the disk; pass the
+    // result to waitUntilDurable to wait for it.
+    uint64_t saveBookingData()
+    {
+        StageTimer timer(Stage::SAVE_BOOKINGS);
+        return writeSnapshot();
+    }
+
+    // Bookings and cancellations are written by the journal writer after
+    // they are confirmed; these report how far the disk has caught up.
+    uint64_t getDurableSequence() const { return journalWriter.getDurableSequence(); }
+    void waitUntilDurable(uint64_t sequence) const { journalWriter.waitUntilDurable(sequence); }
+};
+
+enum class ReportDimension
+{
+    STATE,
+    CITY,
+    THEATER,
+    MOVIE,
+    DATE
+};
+
+bool parseReportDimension(string_view text, ReportDimension &dimension)
+{
+    static const pair<string_view, ReportDimension> names[] = {
+        {"STATE", ReportDimension::STATE}, {"CITY", ReportDimension::CITY}, {"THEATER", ReportDimension::THEATER},
+        {"MOVIE", ReportDimension::MOVIE}, {"DATE", ReportDimension::DATE}};
+    for (const auto &entry : names)
+    {
+        if (entry.first == text)
+        {
+            dimension = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct RollupRow
+{
+    string key;
+    int showtimes = 0;
+    int64_t seatCapacity = 0;
+    int64_t bookings = 0;
+    int64_t seatsBooked = 0;
+    int64_t foodOrders = 0;
+    int64_t ticketPaise = 0;
+    int64_t foodPaise = 0;
+    int64_t discountPaise = 0;
+
+    Money getRevenue() const { return Money::fromPaise(ticketPaise + foodPaise - discountPaise); }
+    double getOccupancyRate() const { return seatCapacity > 0 ? (seatsBooked * 100.0) / seatCapacity : 0.0; }
+    double getFoodAttachRate() const { return bookings > 0 ? (foodOrders * 100.0) / bookings : 0.0; }
+    Money getAverageBasket() const { return bookings > 0 ? getRevenue().dividedBy(bookings) : Money(); }
+};
+
+// Chain-wide revenue and occupancy rollups. Bookings are copied out as
+// columns, split into contiguous ranges and summed per group on worker
+// threads; the per-thread partials are merged at the end.
+class AnalyticsEngine
+{
+private:
+    BookingEngine &engine;
+    unsigned threadCount;
+
+    static string groupKey(const Showtime &show, ReportDimension dimension)
+    {
+        switch (dimension)
+        {
+        case ReportDimension::STATE:
+            return show.getTheater().getState();
+        case ReportDimension::CITY:
+            return show.getTheater().getCity();
+        case ReportDimension::THEATER:
+            return show.getTheater().getName();
+        case ReportDimension::MOVIE:
+            return show.getMovie().getTitle();
+        default:
+            return show.getDate();
+        }
+    }
+
+    static void accumulate(const BookingColumns &columns, const vector<uint32_t> &groupOf,
+                           size_t begin, size_t end, vector<RollupRow> &totals)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            RollupRow &row = totals[groupOf[columns.showtimeIds[i]]];
+            row.bookings++;
+            row.seatsBooked += columns.premiumSeats[i] + columns.standardSeats[i];
+            row.foodOrders += (columns.foodPaise[i] > 0);
+            row.ticketPaise += columns.ticketPaise[i];
+            row.foodPaise += columns.foodPaise[i];
+            row.discountPaise += columns.discountPaise[i];
+        }
+    }
+
+public:
+    explicit AnalyticsEngine(BookingEngine &e, unsigned threads = 0)
+        : engine(e), threadCount(threads ? threads : max(1u, thread::hardware_concurrency())) {}
+
+    vector<RollupRow> rollup(ReportDimension dimension) const
+    {
+        // Map every showtime to its group and total up capacity per group.
+        vector<RollupRow> rows;
+        vector<uint32_t> groupOf;
+        unordered_map<string, uint32_t> groupIndex;
+        for (const Showtime &show : engine.getShowtimes())
+        {
+            auto inserted = groupIndex.emplace(groupKey(show, dimension), static_cast<uint32_t>(rows.size()));
+            if (inserted.second)
+            {
+                rows.emplace_back();
+                rows.back().key = inserted.first->first;
+            }
+            RollupRow &row = rows[inserted.first->second];
+            row.showtimes++;
+            row.seatCapacity += show.getTheater().getCapacity();
+            groupOf.push_back(inserted.first->second);
+        }
+
+        BookingColumns columns = engine.captureColumns();
+        size_t workers = min<size_t>(threadCount, max<size_t>(1, columns.size() / 65536));
+        vector<vector<RollupRow>> partials(workers, vector<RollupRow>(rows.size()));
+        vector<thread> pool;
+        size_t chunk = (columns.size() + workers - 1) / workers;
+        for (size_t w = 0; w < workers; ++w)
+        {
+            size_t begin = min(columns.size(), w * chunk);
+            size_t end = min(columns.size(), begin + chunk);
+            if (w + 1 == workers)
+                accumulate(columns, groupOf, begin, end, partials[w]);
+            else
+                pool.emplace_back(accumulate, cref(columns), cref(groupOf), begin, end, ref(partials[w]));
+        }
+        for (thread &worker : pool)
+            worker.join();
+
+        for (const vector<RollupRow> &partial : partials)
+        {
+            for (size_t g = 0; g < rows.size(); ++g)
+            {
+                rows[g].bookings += partial[g].bookings;
+                rows[g].seatsBooked += partial[g].seatsBooked;
+                rows[g].foodOrders += partial[g].foodOrders;
+                rows[g].ticketPaise += partial[g].ticketPaise;
+                rows[g].foodPaise += partial[g].foodPaise;
+                rows[g].discountPaise += partial[g].discountPaise;
+            }
+        }
+
+        sort(rows.begin(), rows.end(), [](const RollupRow &a, const RollupRow &b) { return a.key < b.key; });
+        return rows;
+    }
+};
+
+string jsonEscape(string_view text)
+{
+    string escaped;
+    escaped.reserve(text.size());
+    for (char ch : text)
+    {
+        if (ch == '"' || ch == '\\')
+        {
+            escaped += '\\';
+            escaped += ch;
+        }
+        else if (static_cast<unsigned char>(ch) < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", ch);
+            escaped += code;
+        }
+        else
+        {
+            escaped += ch;
+        }
+    }
+    return escaped;
+}
+
+// Frames are a 4-byte little-endian length followed by that many bytes.
+// Longer commands are refused before anything is allocated for them.
+const size_t FRAME_HEADER_BYTES = 4;
+const size_t MAX_FRAME_BYTES = 64 * 1024;
+
+uint32_t readFrameLength(const char *header)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(header);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24);
+}
+
+void writeFrameLength(char *header, uint32_t length)
+{
+    for (size_t i = 0; i < FRAME_HEADER_BYTES; ++i)
+        header[i] = static_cast<char>(length >> (8 * i));
+}
+
+// Non-interactive driver for bulk imports and load replay. Reads one command
+// per line, or per frame of command text, and writes one JSON object per
+// line for every result:
+//   SHOWS [<from YYYY-MM-DD> [<to YYYY-MM-DD>]]
+//   SEARCH <TITLE|GENRE|LANGUAGE> <text>
+//   BOOK <showtime id> <seat,seat,...> [<menu no>:<qty>,...] [PROMO=<code>]
+//   BEST <showtime id> <count> <P|S> [<menu no>:<qty>,...] [PROMO=<code>]
+//   HOLD <showtime id> <seat,seat,...>
+//   CONFIRM <showtime id> <hold token> <seat,seat,...> [<menu no>:<qty>,...] [PROMO=<code>]
+//   CANCEL <booking id>
+//   OCCUPANCY <showtime id>
+//   REPORT <STATE|CITY|THEATER|MOVIE|DATE>
+//   METRICS
+// Blank lines and lines starting with '#' are skipped.
+class BatchProcessor
+{
+private:
+    BookingEngine &engine;
+    ostream &out;
+    long sequence;
+    long failures;
+    TransactionArena arena;
+    string_view promoCode;
+    // Tokens of the open holds this processor made, with their expiry tick.
+    // CONFIRM accepts only these, so on a server one connection cannot
+    // confirm another's hold. A token is dropped once CONFIRM has booked or
+    // released its seats; tokenExpiries lists every token in the order it
+    // expires (all holds last SEAT_HOLD_SECONDS), so the rest are dropped
+    // from its front without scanning.
+    unordered_map<uint32_t, uint32_t> heldTokens;
+    deque<pair<uint32_t, uint32_t>> tokenExpiries;
+
+    void forgetExpiredTokens(uint32_t now)
+    {
+        while (!tokenExpiries.empty() && tokenExpiries.front().second <= now)
+        {
+            auto it = heldTokens.find(tokenExpiries.front().first);
+            if (it != heldTokens.end() && it->second == tokenExpiries.front().second)
+                heldTokens.erase(it);
+            tokenExpiries.pop_front();
+        }
+    }
+
+    static bool parseInt(string_view text, int &value)
+    {
+        auto result = from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == errc() && result.ptr == text.data() + text.size();
+    }
+
+    pmr::vector<string_view> splitWords(string_view text, char separator)
+    {
+        pmr::vector<string_view> words(arena.resource());
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            size_t end = text.find(separator, pos);
+            if (end == string_view::npos)
+                end = text.size();
+            if (end > pos)
+                words.push_back(text.substr(pos, end - pos));
+            pos = end + 1;
+        }
+        return words;
+    }
+
+    void beginResult(string_view op, bool ok)
+    {
+        sequence++;
+        if (!ok)
+            failures++;
+        out << "{\"seq\":" << sequence << ",\"op\":\"" << jsonEscape(op) << "\",\"ok\":" << (ok ? "true" : "false");
+    }
+
+    void fail(string_view op, const string &error)
+    {
+        beginResult(op, false);
+        out << ",\"error\":\"" << jsonEscape(error) << "\"}\n";
+    }
+
+    bool parseFoodOrder(const Theater &theater, string_view spec, FoodOrder &order)
+    {
+        const auto &menu = theater.getMenu();
+        for (string_view line : splitWords(spec, ','))
+        {
+            size_t colon = line.find(':');
+            int item, quantity;
+            if (colon == string_view::npos || !parseInt(line.substr(0, colon), item) ||
+                !parseInt(line.substr(colon + 1), quantity) || item < 1 || item > (int)menu.size() || quantity <= 0)
+            {
+                return false;
+            }
+            order.addItem(menu[item - 1], quantity);
+        }
+        return true;
+    }
+
+    void reportBooking(string_view op, const Booking &booking)
+    {
+        beginResult(op, true);
+        out << ",\"booking\":" << booking.getId() << ",\"showtime\":" << booking.getShowtimeId() << ",\"seats\":[";
+        const SeatLayout &layout = booking.getShowtime().getTheater().getSeatLayout();
+        span<const uint16_t> seatIndices = booking.getSeatIndices();
+        for (size_t i = 0; i < seatIndices.size(); ++i)
+        {
+            out << (i ? "," : "") << "\"" << layout.getSeatId(seatIndices[i]) << "\"";
+        }
+        out << "],\"tickets\":" << formatCurrency(booking.getTicketTotal())
+            << ",\"food\":" << formatCurrency(booking.getFoodOrder().getTotalPrice())
+            << ",\"discount\":" << formatCurrency(booking.getAppliedDiscount())
+            << ",\"total\":" << formatCurrency(booking.getGrandTotal()) << "}\n";
+    }
+
+    void confirmHeld(string_view op, Showtime &show, span<const int> seatIndices, uint32_t token, string_view foodSpec)
+    {
+        FoodOrder order(arena.resource());
+        if (!parseFoodOrder(show.getTheater(), foodSpec, order))
+        {
+            engine.releaseSeats(show.getId(), seatIndices, token, arena.resource());
+            fail(op, "invalid food order");
+            return;
+        }
+
+        optional<Booking> booking = engine.confirmBooking(show.getId(), seatIndices, token, order, promoCode, arena.resource());
+        if (!booking)
+        {
+            engine.releaseSeats(show.getId(), seatIndices, token, arena.resource());
+            fail(op, "seat hold lost before confirmation");
+            return;
+        }
+        reportBooking(op, *booking);
+    }
+
+    Showtime *parseShowtime(string_view text)
+    {
+        int id;
+        if (!parseInt(text, id) || id < 0)
+            return nullptr;
+        return engine.getShowtime(static_cast<ShowtimeId>(id));
+    }
+
+    void writeShow(const Showtime &show, bool first)
+    {
+        out << (first ? "" : ",") << "{\"id\":" << show.getId()
+            << ",\"key\":\"" << jsonEscape(show.getUniqueShowId()) << "\""
+            << ",\"capacity\":" << show.getTheater().getCapacity() << "}";
+    }
+
+    // All showtimes, or those starting between two dates (inclusive).
+    void listShows(const pmr::vector<string_view> &args)
+    {
+        chrono::sys_days fromDay, toDay;
+        if (args.size() > 3 || (args.size() >= 2 && !parseCalendarDate(args[1], fromDay)) ||
+            (args.size() == 3 && !parseCalendarDate(args[2], toDay)))
+        {
+            fail(args[0], "usage: SHOWS [<from YYYY-MM-DD> [<to YYYY-MM-DD>]]");
+            return;
+        }
+
+        beginResult("SHOWS", true);
+        out << ",\"shows\":[";
+        if (args.size() == 1)
+        {
+            const StableVector<Showtime> &showtimes = engine.getShowtimes();
+            for (size_t i = 0; i < showtimes.size(); ++i)
+                writeShow(showtimes[i], i == 0);
+        }
+        else
+        {
+            if (args.size() == 2)
+                toDay = fromDay;
+            int64_t dayMinutes = 24 * 60;
+            span<const ShowStart> shows = engine.getCatalog().getShowtimesBetween(
+                fromDay.time_since_epoch().count() * dayMinutes, (toDay.time_since_epoch().count() + 1) * dayMinutes);
+            for (size_t i = 0; i < shows.size(); ++i)
+                writeShow(*engine.getShowtime(shows[i].id), i == 0);
+        }
+        out << "]}\n";
+    }
+
+    void search(const pmr::vector<string_view> &args)
+    {
+        if (args.size() < 3 || (args[1] != "TITLE" && args[1] != "GENRE" && args[1] != "LANGUAGE"))
+        {
+            fail(args[0], "usage: SEARCH <TITLE|GENRE|LANGUAGE> <text>");
+            return;
+        }
+
+        string_view text(args[2].data(), args.back().data() + args.back().size() - args[2].data());
+        const CatalogIndex &catalog = engine.getCatalog();
+        pmr::vector<MovieId> titleMatches(arena.resource());
+        span<const MovieId> matches;
+        if (args[1] == "TITLE")
+        {
+            titleMatches = catalog.findMovies(text, arena.resource());
+            matches = titleMatches;
+        }
+        else
+            matches = (args[1] == "GENRE" ? catalog.findMoviesByGenre(text) : catalog.findMoviesByLanguage(text));
+
+        beginResult(args[0], true);
+        out << ",\"movies\":[";
+        for (size_t i = 0; i < matches.size(); ++i)
+        {
+            out << (i ? "," : "") << "{\"id\":" << matches[i]
+                << ",\"title\":\"" << jsonEscape(engine.getMovies()[matches[i]].getTitle()) << "\",\"showtimes\":[";
+            span<const ShowtimeId> shows = catalog.getShowtimesOf(matches[i]);
+            for (size_t k = 0; k < shows.size(); ++k)
+                out << (k ? "," : "") << shows[k];
+            out << "]}";
+        }
+        out << "]}\n";
+    }
+
+    // Reports the first bad seat id and returns false.
+    bool parseSeats(string_view op, const Showtime &show, string_view spec, pmr::vector<int> &seatIndices)
+    {
+        const SeatLayout &layout = show.getTheater().getSeatLayout();
+        for (string_view seatText : splitWords(spec, ','))
+        {
+            string seatId(seatText);
+            transform(seatId.begin(), seatId.end(), seatId.begin(), ::toupper);
+            int row, column;
+            if (!layout.findSeat(seatId, row, column))
+            {
+                fail(op, "invalid seat id " + seatId);
+                return false;
+            }
+            seatIndices.push_back(layout.getSeatIndex(row, column));
+        }
+        return true;
+    }
+
+    void book(const pmr::vector<string_view> &args)
+    {
+        Showtime *show = (args.size() >= 3 ? parseShowtime(args[1]) : nullptr);
+        if (!show || args.size() > 4)
+        {
+            fail(args[0], "usage: BOOK <showtime id> <seat,seat,...> [<menu no>:<qty>,...] [PROMO=<code>]");
+            return;
+        }
+
+        pmr::vector<int> seatIndices(arena.resource());
+        if (!parseSeats(args[0], *show, args[2], seatIndices))
+            return;
+
+        uint32_t token = engine.openSession();
+        if (!engine.holdSeats(show->getId(), seatIndices, token, SEAT_HOLD_SECONDS, arena.resource()))
+        {
+            fail(args[0], "seats unavailable");
+            return;
+        }
+        confirmHeld(args[0], *show, seatIndices, token, args.size() > 3 ? args[3] : string_view());
+    }
+
+    void bookBest(const pmr::vector<string_view> &args)
+    {
+        Showtime *show = (args.size() >= 4 ? parseShowtime(args[1]) : nullptr);
+        int count;
+        if (!show || args.size() > 5 || !parseInt(args[2], count) || (args[3] != "P" && args[3] != "S"))
+        {
+            fail(args[0], "usage: BEST <showtime id> <count> <P|S> [<menu no>:<qty>,...] [PROMO=<code>]");
+            return;
+        }
+
+        uint32_t token = engine.openSession();
+        pmr::vector<int> block = engine.holdBestSeats(show->getId(), count, args[3] == "P" ? Seat::PREMIUM : Seat::STANDARD,
+                                                      token, SEAT_HOLD_SECONDS, arena.resource());
+        if (block.empty())
+        {
+            fail(args[0], "no adjacent block available");
+            return;
+        }
+        confirmHeld(args[0], *show, block, token, args.size() > 4 ? args[4] : string_view());
+    }
+
+    // First half of BOOK: the seats stay held for the returned token until
+    // CONFIRM or the hold expires.
+    void hold(const pmr::vector<string_view> &args)
+    {
+        Showtime *show = (args.size() == 3 ? parseShowtime(args[1]) : nullptr);
+        if (!show)
+        {
+            fail(args[0], "usage: HOLD <showtime id> <seat,seat,...>");
+            return;
+        }
+
+        pmr::vector<int> seatIndices(arena.resource());
+        if (!parseSeats(args[0], *show, args[2], seatIndices))
+            return;
+
+        uint32_t token = engine.openSession();
+        if (!engine.holdSeats(show->getId(), seatIndices, token, SEAT_HOLD_SECONDS, arena.resource()))
+        {
+            fail(args[0], "seats unavailable");
+            return;
+        }
+        uint32_t now = currentHoldTick();
+        uint32_t expiry = now + SEAT_HOLD_SECONDS * HOLD_TICKS_PER_SECOND;
+        forgetExpiredTokens(now);
+        heldTokens[token] = expiry;
+        tokenExpiries.emplace_back(token, expiry);
+        beginResult(args[0], true);
+        out << ",\"showtime\":" << show->getId() << ",\"token\":" << token
+            << ",\"expires_in\":" << SEAT_HOLD_SECONDS << "}\n";
+    }
+
+    void confirm(const pmr::vector<string_view> &args)
+    {
+        Showtime *show = (args.size() >= 4 ? parseShowtime(args[1]) : nullptr);
+        uint32_t token = 0;
+        if (show && args.size() <= 5)
+        {
+            auto result = from_chars(args[2].data(), args[2].data() + args[2].size(), token);
+            if (result.ec != errc() || result.ptr != args[2].data() + args[2].size())
+                token = 0;
+        }
+        if (!token)
+        {
+            fail(args[0], "usage: CONFIRM <showtime id> <hold token> <seat,seat,...> [<menu no>:<qty>,...] [PROMO=<code>]");
+            return;
+        }
+
+        if (!heldTokens.contains(token))
+        {
+            fail(args[0], "unknown hold token");
+            return;
+        }
+
+        pmr::vector<int> seatIndices(arena.resource());
+        if (!parseSeats(args[0], *show, args[3], seatIndices))
+            return;
+        // Booked or released either way, so the token is spent.
+        heldTokens.erase(token);
+        confirmHeld(args[0], *show, seatIndices, token, args.size() > 4 ? args[4] : string_view());
+    }
+
+    void cancel(const pmr::vector<string_view> &args)
+    {
+        int bookingId;
+        if (args.size() != 2 || !parseInt(args[1], bookingId))
+        {
+            fail(args[0], "usage: CANCEL <booking id>");
+            return;
+        }
+        if (!engine.cancelBooking(bookingId))
+        {
+            fail(args[0], "booking not found");
+            return;
+        }
+        beginResult(args[0], true);
+        out << ",\"booking\":" << bookingId << "}\n";
+    }
+
+    void occupancy(const pmr::vector<string_view> &args)
+    {
+        Showtime *show = (args.size() == 2 ? parseShowtime(args[1]) : nullptr);
+        if (!show)
+        {
+            fail(args[0], "usage: OCCUPANCY <showtime id>");
+            return;
+        }
+        beginResult(args[0], true);
+        out << ",\"showtime\":" << show->getId()
+            << ",\"booked\":" << show->getSeatInventory().countBooked()
+            << ",\"capacity\":" << show->getTheater().getCapacity()
+            << ",\"occupancy\":" << formatNumber(PriceCalculator::calculateOccupancyRate(*show))
+            << ",\"bookings\":" << show->getCounters().bookings.load()
+            << ",\"ticket_revenue\":" << formatCurrency(show->getCounters().ticketRevenue())
+            << ",\"food_revenue\":" << formatCurrency(show->getCounters().foodRevenue())
+            << ",\"theater_occupancy\":" << formatNumber(PriceCalculator::calculateOccupancyRate(show->getTheater())) << "}\n";
+    }
+
+    void metrics(const pmr::vector<string_view> &args)
+    {
+        if (args.size() != 1)
+        {
+            fail(args[0], "usage: METRICS");
+            return;
+        }
+        beginResult(args[0], true);
+        out << ",\"stages\":";
+        StageMetrics::instance().writeJson(out);
+        out << "}\n";
+    }
+
+    void report(const pmr::vector<string_view> &args)
+    {
+        ReportDimension dimension;
+        if (args.size() != 2 || !parseReportDimension(args[1], dimension))
+        {
+            fail(args[0], "usage: REPORT <STATE|CITY|THEATER|MOVIE|DATE>");
+            return;
+        }
+        vector<RollupRow> rows = AnalyticsEngine(engine).rollup(dimension);
+        beginResult(args[0], true);
+        out << ",\"by\":\"" << args[1] << "\",\"rows\":[";
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            const RollupRow &row = rows[i];
+            out << (i ? "," : "") << "{\"key\":\"" << jsonEscape(row.key) << "\""
+                << ",\"showtimes\":" << row.showtimes << ",\"bookings\":" << row.bookings
+                << ",\"seats\":" << row.seatsBooked
+                << ",\"revenue\":" << formatCurrency(row.getRevenue())
+                << ",\"occupancy\":" << formatNumber(row.getOccupancyRate())
+                << ",\"food_attach\":" << formatNumber(row.getFoodAttachRate())
+                << ",\"avg_basket\":" << formatCurrency(row.getAverageBasket()) << "}";
+        }
+        out << "]}\n";
+    }
+
+public:
+    BatchProcessor(BookingEngine &e, ostream &o) : engine(e), out(o), sequence(0), failures(0) {}
+
+    long getProcessedCount() const { return sequence; }
+    long getFailureCount() const { return failures; }
+    const TransactionArena &getArena() const { return arena; }
+
+    // Each command is one transaction; its scratch memory is dropped before the next.
+    void execute(string_view command)
+    {
+        arena.reset();
+        if (!command.empty() && command.back() == '\r')
+            command.remove_suffix(1);
+
+        pmr::vector<string_view> args = splitWords(command, ' ');
+        if (args.empty() || args[0][0] == '#')
+            return;
+
+        promoCode = string_view();
+        if ((args[0] == "BOOK" || args[0] == "BEST" || args[0] == "CONFIRM") && args.back().substr(0, 6) == "PROMO=")
+        {
+            promoCode = args.back().substr(6);
+            args.pop_back();
+        }
+
+        if (args[0] == "SHOWS")
+            listShows(args);
+        else if (args[0] == "SEARCH")
+            search(args);
+        else if (args[0] == "BOOK")
+            book(args);
+        else if (args[0] == "BEST")
+            bookBest(args);
+        else if (args[0] == "HOLD")
+            hold(args);
+        else if (args[0] == "CONFIRM")
+            confirm(args);
+        else if (args[0] == "CANCEL")
+            cancel(args);
+        else if (args[0] == "OCCUPANCY")
+            occupancy(args);
+        else if (args[0] == "REPORT")
+            report(args);
+        else if (args[0] == "METRICS")
+            metrics(args);
+        else
+            fail(args[0], "unknown command");
+    }
+
+    void run(istream &in, bool framed)
+    {
+        string command;
+        if (!framed)
+        {
+            while (getline(in, command))
+            {
+                execute(command);
+            }
+            return;
+        }
+
+        char header[FRAME_HEADER_BYTES];
+        while (in.read(header, sizeof(header)))
+        {
+            uint32_t length = readFrameLength(header);
+            if (length > MAX_FRAME_BYTES)
+            {
+                fail("FRAME", "frame too large");
+                return;
+            }
+            command.resize(length);
+            if (!in.read(&command[0], length))
+            {
+                fail("FRAME", "truncated frame");
+                return;
+            }
+            execute(command);
+        }
+    }
+};
+
+// Thrown inside a dialog when its channel closes with no line left to read.
+class SessionClosed : public runtime_error
+{
+public:
+    SessionClosed() : runtime_error("session input closed") {}
+};
+
+template <typename T>
+struct TaskResult
+{
+    optional<T> value;
+    void return_value(T result) { value.emplace(move(result)); }
+    T take() { return move(*value); }
+};
+
+template <>
+struct TaskResult<void>
+{
+    void return_void() {}
+    void take() {}
+};
+
+// Lazily started coroutine producing a T. Awaiting a Task runs it on the
+// awaiting thread and resumes the awaiter with its result (or exception)
+// when it finishes, so dialog steps call each other like ordinary
+// functions while any of them may suspend waiting for input.
+template <typename T = void>
+class Task
+{
+public:
+    struct promise_type : TaskResult<T>
+    {
+        coroutine_handle<> continuation = noop_coroutine();
+        exception_ptr error;
+
+        Task get_return_object() { return Task(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            coroutine_handle<> await_suspend(coroutine_handle<promise_type> handle) noexcept
+            {
+                return handle.promise().continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() { error = current_exception(); }
+    };
+
+private:
+    coroutine_handle<promise_type> handle;
+
+    explicit Task(coroutine_handle<promise_type> h) : handle(h) {}
+
+public:
+    Task(Task &&other) noexcept : handle(exchange(other.handle, nullptr)) {}
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle)
+            handle.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    coroutine_handle<> await_suspend(coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        if (handle.promise().error)
+            rethrow_exception(handle.promise().error);
+        return handle.promise().take();
+    }
+
+    // For a top-level task: runs it until it first suspends.
+    void start() { handle.resume(); }
+    bool isDone() const { return handle.done(); }
+
+    void rethrowIfFailed() const
+    {
+        if (handle.done() && handle.promise().error)
+            rethrow_exception(handle.promise().error);
+    }
+};
+
+// The customer's side of one dialog: lines typed in, text written out. A
+// socket, a console or a test script pushes lines; the dialog awaits
+// nextLine() and whoever pushed takes the reader back to resume it.
+class SessionChannel
+{
+private:
+    deque<string> lines;
+    bool closed = false;
+    coroutine_handle<> reader;
+    stringbuf output;
+
+public:
+    class LineAwaiter
+    {
+    private:
+        SessionChannel &channel;
+
+    public:
+        explicit LineAwaiter(SessionChannel &c) : channel(c) {}
+
+        bool await_ready() const { return !channel.lines.empty() || channel.closed; }
+        void await_suspend(coroutine_handle<> handle) { channel.reader = handle; }
+
+        string await_resume()
+        {
+            if (channel.lines.empty())
+                throw SessionClosed();
+            string line = move(channel.lines.front());
+            channel.lines.pop_front();
+            return line;
+        }
+    };
+
+    LineAwaiter nextLine() { return LineAwaiter(*this); }
+
+    void push(string line) { lines.push_back(move(line)); }
+    void close() { closed = true; }
+
+    // The suspended reader, once there is a line (or the end) for it.
+    coroutine_handle<> takeReader()
+    {
+        if (reader && (!lines.empty() || closed))
+            return exchange(reader, nullptr);
+        return nullptr;
+    }
+
+    streambuf *getOutputBuffer() { return &output; }
+
+    string takeOutput()
+    {
+        string text = output.str();
+        output.str(string());
+        return text;
+    }
+};
+
+// The interactive booking flow for one customer, written as coroutines that
+// read from a SessionChannel. Output goes to cout, which SessionLoop points
+// at the session's channel while the dialog runs.
+class BookingDialog
+{
+private:
+    BookingEngine &engine;
+    SessionChannel &channel;
+    TransactionArena arena;
+
+    Task<string> readLine()
+    {
+        co_return co_await channel.nextLine();
+    }
+
+    // First word of the next non-blank line.
+    Task<string> readWord()
+    {
+        while (true)
+        {
+            string line = co_await channel.nextLine();
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin != string::npos)
+                co_return line.substr(begin, line.find_first_of(" \t\r", begin) - begin);
+        }
+    }
+
+    // Prompts until a line holds exactly one whole number.
+    Task<int> readInt(string prompt)
+    {
+        while (true)
+        {
+            cout << prompt;
+            string line;
+            do
+            {
+                line = co_await channel.nextLine();
+            } while (line.find_first_not_of(" \t\r") == string::npos);
+
+            size_t begin = line.find_first_not_of(" \t\r");
+            size_t end = line.find_last_not_of(" \t\r") + 1;
+            int input;
+            auto result = from_chars(line.data() + begin, line.data() + end, input);
+            if (result.ec == errc() && result.ptr == line.data() + end)
+                co_return input;
+            cout << "Invalid input. Please enter a valid number." << endl;
+        }
+    }
+
+    // One line per food offer in the show's pricing rules.
+    static void printFoodOffers(const Showtime &show)
+    {
+        show.getPricing().forEachFoodOffer([](const PricingRule &rule)
+        {
+            cout << "** Spend over Rs " << formatCurrency(rule.minFood) << " on food";
+            if (rule.minSeats > 0)
+                cout << " with " << rule.minSeats << " or more seats";
+            cout << " to get ";
+            if (rule.effect == PricingRule::FOOD_PERCENT_OFF)
+                cout << rule.value << "% off your food";
+            else if (rule.effect == PricingRule::TICKETS_PERCENT_OFF)
+                cout << rule.value << "% off your tickets";
+            else
+                cout << "Rs " << formatCurrency(Money::fromPaise(rule.value)) << " off";
+            cout << "! **" << endl;
+        });
+    }
+
+    Task<FoodOrder> selectFoodItems(Showtime &selectedShowtime, int seatCount)
+    {
+        StageTimer timer(Stage::FOOD_ORDER);
+        Theater &selectedTheater = selectedShowtime.getTheater();
+        FoodOrder order(arena.resource());
+        pmr::string offers(arena.resource()), earned(arena.resource());
+        int foodChoice;
+        int quantity;
+        const auto &menu = selectedTheater.getMenu();
+
+        printHeader("STEP 4: Select Food & Beverages (Optional)");
+        cout << "You are ordering from the menu of " << selectedTheater.getName() << "." << endl;
+        printFoodOffers(selectedShowtime);
+
+        do
+        {
+            cout << "\n"
+                 << LINE_SEPARATOR << endl;
+            cout << "Menu: " << endl;
+            for (size_t i = 0; i < menu.size(); ++i)
+            {
+                menu[i].displayItem(i + 1);
+            }
+            cout << LINE_SEPARATOR << endl;
+            cout << "[0] Proceed to Payment (Skip Food / Finish Order)" << endl;
+
+            foodChoice = co_await readInt("Enter menu number to add, or 0 to continue: ");
+
+            if (foodChoice >= 1 && foodChoice <= (int)menu.size())
+            {
+                quantity = co_await readInt("Enter quantity for " + menu[foodChoice - 1].getName() + ": ");
+                order.addItem(menu[foodChoice - 1], quantity);
+                cout << "-> Added " << quantity << " x " << menu[foodChoice - 1].getName() << " to your order." << endl;
+                order.displayOrder();
+
+                // Name the show's offers the order now earns, as the bill
+                // will; a promo code is only asked for afterwards.
+                selectedShowtime.getPricing().getOrderDiscount(seatCount, Money(), order, string_view(), offers);
+                if (!offers.empty() && offers != earned)
+                {
+                    cout << "\n    ** You qualify for: " << offers << " **" << endl;
+                }
+                earned = offers;
+            }
+            else if (foodChoice != 0)
+            {
+                cout << "Invalid menu number. Please select from 1 to " << menu.size() << "." << endl;
+            }
+        } while (foodChoice != 0);
+
+        co_return order;
+    }
+
+    Task<pmr::vector<int>> selectSeats(Showtime &selectedShowtime, uint32_t sessionToken)
+    {
+        StageTimer timer(Stage::SEAT_SELECTION);
+        Theater &theater = selectedShowtime.getTheater();
+        SeatInventory &seats = selectedShowtime.getSeatInventory();
+        const SeatLayout &layout = seats.getLayout();
+        pmr::vector<int> selectedSeats(arena.resource());
+        string seatIdInput;
+        bool done = false;
+
+        printHeader("STEP 3: Select Seats");
+        cout << "Theater: " << theater.getName() << " | Movie: " << selectedShowtime.getMovie().getTitle()
+             << " | Time: " << selectedShowtime.getTime() << endl;
+        cout << "Legend: [S=Standard, P=Premium, X=Booked, V=Selected]" << endl;
+        cout << "Standard Price: Rs " << formatCurrency(selectedShowtime.getSeatPrice(Seat::STANDARD))
+             << " | Premium Price: Rs " << formatCurrency(selectedShowtime.getSeatPrice(Seat::PREMIUM)) << endl;
+        cout << "Selected seats are held for you for " << SEAT_HOLD_SECONDS / 60 << " minutes." << endl;
+
+        while (!done)
+        {
+            cout << LINE_SEPARATOR << endl;
+
+            for (int row = 0; row < layout.getRowCount(); ++row)
+            {
+                cout << "Row " << layout.getRowLetter(row) << " | ";
+                seats.displayRow(row);
+                cout << endl;
+            }
+            cout << LINE_SEPARATOR << endl;
+
+            cout << "Enter Seat ID to select/deselect (e.g., A1, P5, C10), 'BEST' for best available, or 'DONE' to finish: ";
+            seatIdInput = co_await readWord();
+
+            transform(seatIdInput.begin(), seatIdInput.end(), seatIdInput.begin(), ::toupper);
+
+            if (seatIdInput == "DONE")
+            {
+                if (selectedSeats.empty())
+                {
+                    cout << "Please select at least one seat before proceeding." << endl;
+                    continue;
+                }
+                done = true;
+                break;
+            }
+
+            if (seatIdInput == "BEST")
+            {
+                int count = co_await readInt("How many adjacent seats? ");
+                cout << "Seat class - [P]remium or [S]tandard: ";
+                string classChoice = co_await readWord();
+
+                Seat::Type type = (toupper(classChoice[0]) == 'P' ? Seat::PREMIUM : Seat::STANDARD);
+                pmr::vector<int> block = engine.holdBestSeats(selectedShowtime.getId(), count, type, sessionToken,
+                                                              SEAT_HOLD_SECONDS, arena.resource());
+                if (block.empty())
+                {
+                    cout << "No block of " << count << " adjacent " << (type == Seat::PREMIUM ? "premium" : "standard")
+                         << " seats is available." << endl;
+                    continue;
+                }
+                selectedSeats.insert(selectedSeats.end(), block.begin(), block.end());
+                cout << "-> Best available seats held. Current Selections: ";
+                for (int index : selectedSeats)
+                    cout << layout.getSeatId(index) << " ";
+                cout << endl;
+                continue;
+            }
+
+            int row, column;
+            if (!layout.findSeat(seatIdInput, row, column))
+            {
+                cout << "Invalid Seat ID: " << seatIdInput << ". Please check the map and try again." << endl;
+                continue;
+            }
+
+            int seatIndex = layout.getSeatIndex(row, column);
+            if (seats.isHeldBy(row, column, sessionToken))
+            {
+                engine.releaseSeats(selectedShowtime.getId(), span<const int>(&seatIndex, 1), sessionToken, arena.resource());
+                selectedSeats.erase(remove(selectedSeats.begin(), selectedSeats.end(), seatIndex), selectedSeats.end());
+                cout << "-> Seat " << seatIdInput << " deselected. Current Selections: ";
+            }
+            else if (engine.holdSeats(selectedShowtime.getId(), span<const int>(&seatIndex, 1), sessionToken,
+                                      SEAT_HOLD_SECONDS, arena.resource()))
+            {
+                selectedSeats.push_back(seatIndex);
+                cout << "-> Seat " << seatIdInput << " selected. Current Selections: ";
+            }
+            else if (seats.getStatus(row, column) == Seat::BOOKED)
+            {
+                cout << "Seat " << seatIdInput << " is already BOOKED (X). Select another seat." << endl;
+                continue;
+            }
+            else
+            {
+                cout << "Seat " << seatIdInput << " is being held by another customer. Select another seat." << endl;
+                continue;
+            }
+
+            for (int index : selectedSeats)
+                cout << layout.getSeatId(index) << " ";
+            cout << endl;
+        }
+
+        co_return selectedSeats;
+    }
+
+    Task<string> selectLocation()
+    {
+        int stateChoice, cityChoice;
+        string selectedState, selectedCity;
+
+        printHeader("STEP 1.1: Select Location (State)");
+        const vector<string> &states = engine.getStates();
+        for (size_t i = 0; i < states.size(); ++i)
+        {
+            cout << "[" << i + 1 << "] " << states[i] << endl;
+        }
+
+        while (true)
+        {
+            stateChoice = co_await readInt("Enter State number: ");
+            if (stateChoice >= 1 && stateChoice <= (int)states.size())
+            {
+                selectedState = states[stateChoice - 1];
+                cout << "-> Selected State: " << selectedState << endl;
+                break;
+            }
+            cout << "Invalid state selection." << endl;
+        }
+
+        span<const string> cities = engine.getCatalog().getCities(selectedState);
+
+        printHeader("STEP 1.2: Select Location (City)");
+        for (size_t i = 0; i < cities.size(); ++i)
+        {
+            cout << "[" << i + 1 << "] " << cities[i] << endl;
+        }
+
+        while (true)
+        {
+            cityChoice = co_await readInt("Enter City number: ");
+            if (cityChoice >= 1 && cityChoice <= (int)cities.size())
+            {
+                selectedCity = cities[cityChoice - 1];
+                cout << "-> Selected City: " << selectedCity << endl;
+                break;
+            }
+            cout << "Invalid city selection." << endl;
+        }
+
+        co_return selectedCity;
+    }
+
+    Task<Theater *> selectTheater(string city)
+    {
+        pmr::vector<Theater *> cityTheaters(arena.resource());
+        for (TheaterId id : engine.getCatalog().getTheatersIn(city))
+        {
+            cityTheaters.push_back(&engine.getTheaters()[id]);
+        }
+
+        if (cityTheaters.empty())
+        {
+            cout << "No theaters available in " << city << "." << endl;
+            co_return nullptr;
+        }
+
+        printHeader("STEP 2.1: Select Theater");
+        cout << "Available theaters in " << city << ":" << endl;
+
+        for (size_t i = 0; i < cityTheaters.size(); ++i)
+        {
+            cout << "  [" << i + 1 << "] " << cityTheaters[i]->getName() << endl;
+        }
+
+        while (true)
+        {
+            int theaterChoice = co_await readInt("Enter Theater number: ");
+            if (theaterChoice >= 1 && theaterChoice <= (int)cityTheaters.size())
+            {
+                Theater *selectedTheater = cityTheaters[theaterChoice - 1];
+                cout << "-> Selected Theater: " << selectedTheater->getName() << endl;
+                selectedTheater->displayLocationInfo(); // Using polymorphism
+                co_return selectedTheater;
+            }
+            cout << "Invalid theater number." << endl;
+        }
+    }
+
+    Task<Showtime *> selectShowtimeForTheater(Theater &theater)
+    {
+        string filterMovieTitle;
+        cout << "\nDo you want to filter showtimes by a movie title? (Y/N): ";
+        string filterChoice = co_await readWord();
+
+        if (toupper(filterChoice[0]) == 'Y')
+        {
+            cout << "Enter part of the movie title to filter (e.g., 'Architect'): ";
+            filterMovieTitle = co_await readLine();
+            cout << "Filtering for movies containing: '" << filterMovieTitle << "'" << endl;
+        }
+
+        const CatalogIndex &catalog = engine.getCatalog();
+        pmr::vector<MovieId> matchingMovies = catalog.findMovies(filterMovieTitle, arena.resource());
+        pmr::vector<Showtime *> theaterShowtimes(arena.resource());
+
+        for (ShowtimeId id : catalog.getShowtimesAt(theater.getId()))
+        {
+            Showtime &show = *engine.getShowtime(id);
+            if (filterMovieTitle.empty() ||
+                binary_search(matchingMovies.begin(), matchingMovies.end(), show.getMovie().getId()))
+            {
+                theaterShowtimes.push_back(&show);
+            }
+        }
+
+        if (theaterShowtimes.empty())
+        {
+            cout << "No showtimes available at " << theater.getName();
+            if (!filterMovieTitle.empty())
+            {
+                cout << " matching your filter.";
+            }
+            cout << endl;
+            co_return nullptr;
+        }
+
+        printHeader("STEP 2.2: Select Showtime (Time & Movie)");
+        cout << "Showtimes at " << theater.getName() << ":" << endl;
+
+        for (size_t i = 0; i < theaterShowtimes.size(); ++i)
+        {
+            theaterShowtimes[i]->displayDetails(i + 1);
+        }
+
+        while (true)
+        {
+            int showChoice = co_await readInt("Enter Showtime number to book: ");
+            if (showChoice >= 1 && showChoice <= (int)theaterShowtimes.size())
+            {
+                Showtime *selectedShow = theaterShowtimes[showChoice - 1];
+                cout << "-> Confirmed: " << selectedShow->getMovie().getTitle()
+                     << " at " << selectedShow->getTime() << endl;
+                co_return selectedShow;
+            }
+            cout << "Invalid showtime number." << endl;
+        }
+    }
+
+    Task<> cancelBooking()
+    {
+        printHeader("BOOKING CANCELLATION");
+        vector<Booking> bookings = engine.listBookings();
+        if (bookings.empty())
+        {
+            cout << "There are no successful bookings to cancel." << endl;
+            co_return;
+        }
+
+        cout << "Existing Bookings:" << endl;
+        for (const auto &booking : bookings)
+        {
+            booking.displayBriefDetails();
+        }
+        cout << LINE_SEPARATOR << endl;
+
+        int bookingIdToCancel = co_await readInt("Enter the Reference ID of the booking to cancel (or 0 to abort): ");
+        if (bookingIdToCancel == 0)
+        {
+            cout << "Cancellation aborted." << endl;
+            co_return;
+        }
+
+        if (!engine.bookingExists(bookingIdToCancel))
+        {
+            cout << "Error: Booking ID " << bookingIdToCancel << " not found." << endl;
+            co_return;
+        }
+
+        cout << "\n--- Confirmation ---" << endl;
+        cout << "Are you sure you want to cancel booking ID " << bookingIdToCancel << "? (Y/N): ";
+        string confirm = co_await readWord();
+
+        if (toupper(confirm[0]) != 'Y')
+        {
+            cout << "Cancellation operation aborted by user." << endl;
+            co_return;
+        }
+
+        if (engine.cancelBooking(bookingIdToCancel))
+        {
+            cout << "\n>> BOOKING ID " << bookingIdToCancel << " HAS BEEN SUCCESSFULLY CANCELED." << endl;
+            cout << ">> Corresponding seats are now AVAILABLE." << endl;
+        }
+        else
+        {
+            cout << "Error: Booking ID " << bookingIdToCancel << " not found." << endl;
+        }
+    }
+
+public:
+    BookingDialog(BookingEngine &e, SessionChannel &c) : engine(e), channel(c), arena(SESSION_ARENA_BYTES) {}
+
+    BookingDialog(const BookingDialog &) = delete;
+    BookingDialog &operator=(const BookingDialog &) = delete;
+
+    // Runs the dialog until the customer exits or the channel closes.
+    Task<> run()
+    {
+        try
+        {
+            co_await runMenu();
+        }
+        catch (const SessionClosed &)
+        {
+        }
+    }
+
+private:
+    Task<> runMenu()
+    {
+        while (true)
+        {
+            // Everything left in the arena belonged to the previous transaction.
+            arena.reset();
+            printHeader("MAIN MENU");
+            cout << "[1] Start New Booking" << endl;
+            cout << "[2] Cancel Existing Booking" << endl;
+            cout << "[3] Exit Application" << endl;
+            cout << LINE_SEPARATOR << endl;
+
+            int mainChoice = co_await readInt("Enter your choice: ");
+
+            if (mainChoice == 3)
+            {
+                break;
+            }
+            else if (mainChoice == 2)
+            {
+                co_await cancelBooking();
+                continue;
+            }
+            else if (mainChoice != 1)
+            {
+                cout << "Invalid choice. Please select 1, 2, or 3." << endl;
+                continue;
+            }
+
+            string selectedCity = co_await selectLocation();
+
+            Theater *selectedTheaterPtr = co_await selectTheater(selectedCity);
+
+            if (!selectedTheaterPtr)
+            {
+                cout << "\nBooking process aborted. No theater selected." << endl;
+                continue;
+            }
+
+            Showtime *selectedShowtimePtr = co_await selectShowtimeForTheater(*selectedTheaterPtr);
+
+            if (!selectedShowtimePtr)
+            {
+                cout << "\nBooking process aborted. No showtime selected." << endl;
+                continue;
+            }
+
+            Showtime &selectedShowtime = *selectedShowtimePtr;
+
+            uint32_t sessionToken = engine.openSession();
+            pmr::vector<int> bookedSeats = co_await selectSeats(selectedShowtime, sessionToken);
+
+            if (bookedSeats.empty())
+            {
+                cout << "\nBooking process aborted. No seats selected." << endl;
+                continue;
+            }
+
+            FoodOrder finalFoodOrder = co_await selectFoodItems(selectedShowtime, static_cast<int>(bookedSeats.size()));
+
+            cout << "\nEnter a promo code (or press Enter to skip): ";
+            string promoCode = co_await readLine();
+
+            optional<Booking> finalBooking = engine.confirmBooking(selectedShowtime.getId(), bookedSeats, sessionToken,
+                                                                   finalFoodOrder, promoCode, arena.resource());
+            if (!finalBooking)
+            {
+                engine.releaseSeats(selectedShowtime.getId(), bookedSeats, sessionToken);
+                cout << "\nBooking could not be confirmed: your seat hold expired. Please start again." << endl;
+                continue;
+            }
+            finalBooking->generateBill();
+
+            cout << "\nPress Enter to return to the main menu...";
+            co_await readLine();
+        }
+    }
+};
+
+// Multiplexes booking dialogs on the calling thread. Each session is a
+// coroutine suspended on its channel; feeding it a line resumes it until
+// it next waits for input, so an idle session costs its coroutine frames
+// and buffers rather than a thread. While a session runs, cout writes to
+// that session's channel.
+class SessionLoop
+{
+private:
+    struct Session
+    {
+        SessionChannel channel;
+        BookingDialog dialog;
+        Task<> task;
+
+        explicit Session(BookingEngine &engine) : dialog(engine, channel), task(dialog.run()) {}
+    };
+
+    BookingEngine &engine;
+    unordered_map<uint32_t, unique_ptr<Session>> sessions;
+    uint32_t nextSessionId;
+
+    Session &getSession(uint32_t id)
+    {
+        auto it = sessions.find(id);
+        if (it == sessions.end())
+            throw invalid_argument("unknown session " + to_string(id));
+        return *it->second;
+    }
+
+    template <typename Step>
+    void runSession(Session &session, Step step)
+    {
+        streambuf *console = cout.rdbuf(session.channel.getOutputBuffer());
+        try
+        {
+            step();
+        }
+        catch (...)
+        {
+            cout.rdbuf(console);
+            throw;
+        }
+        cout.rdbuf(console);
+        session.task.rethrowIfFailed();
+    }
+
+    void resumeReader(Session &session)
+    {
+        if (coroutine_handle<> reader = session.channel.takeReader())
+            runSession(session, [reader]() { reader.resume(); });
+    }
+
+public:
+    explicit SessionLoop(BookingEngine &e) : engine(e), nextSessionId(1) {}
+
+    // Starts a dialog; it runs up to its first prompt.
+    uint32_t open()
+    {
+        uint32_t id = nextSessionId++;
+        Session &session = *sessions.emplace(id, make_unique<Session>(engine)).first->second;
+        runSession(session, [&session]() { session.task.start(); });
+        return id;
+    }
+
+    void feed(uint32_t id, string line)
+    {
+        Session &session = getSession(id);
+        session.channel.push(move(line));
+        resumeReader(session);
+    }
+
+    // End of input: a dialog still waiting unwinds and finishes.
+    void close(uint32_t id)
+    {
+        Session &session = getSession(id);
+        session.channel.close();
+        resumeReader(session);
+    }
+
+    string takeOutput(uint32_t id) { return getSession(id).channel.takeOutput(); }
+    bool isFinished(uint32_t id) { return getSession(id).task.isDone(); }
+    void erase(uint32_t id) { sessions.erase(id); }
+    size_t size() const { return sessions.size(); }
+};
+
+#ifdef __linux__
+// "unix:<path>" or "[<IPv4 address>:]<port>"; a bare port means 127.0.0.1.
+bool parseSocketAddress(const string &text, sockaddr_storage &address, socklen_t &length)
+{
+    memset(&address, 0, sizeof(address));
+    if (text.rfind("unix:", 0) == 0)
+    {
+        sockaddr_un &local = reinterpret_cast<sockaddr_un &>(address);
+        string path = text.substr(5);
+        if (path.empty() || path.size() >= sizeof(local.sun_path))
+            return false;
+        local.sun_family = AF_UNIX;
+        memcpy(local.sun_path, path.data(), path.size());
+        length = sizeof(sockaddr_un);
+        return true;
+    }
+
+    size_t colon = text.rfind(':');
+    string host = (colon == string::npos ? "127.0.0.1" : text.substr(0, colon));
+    string portText = (colon == string::npos ? text : text.substr(colon + 1));
+    int port;
+    auto result = from_chars(portText.data(), portText.data() + portText.size(), port);
+    sockaddr_in &inet = reinterpret_cast<sockaddr_in &>(address);
+    if (result.ec != errc() || result.ptr != portText.data() + portText.size() || port <= 0 || port > 65535 ||
+        inet_pton(AF_INET, host.c_str(), &inet.sin_addr) != 1)
+    {
+        return false;
+    }
+    inet.sin_family = AF_INET;
+    inet.sin_port = htons(static_cast<uint16_t>(port));
+    length = sizeof(sockaddr_in);
+    return true;
+}
+
+// Appends everything written through it to a string, so a BatchProcessor's
+// results land directly in a connection's send buffer.
+class StringAppendBuffer : public streambuf
+{
+private:
+    string &target;
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            target.push_back(traits_type::to_char_type(ch));
+        return traits_type::not_eof(ch);
+    }
+
+    streamsize xsputn(const char *text, streamsize count) override
+    {
+        target.append(text, static_cast<size_t>(count));
+        return count;
+    }
+
+public:
+    explicit StringAppendBuffer(string &t) : target(t) {}
+};
+
+const size_t SERVER_READ_CHUNK = 64 * 1024;
+// A client that stops reading its responses is not read from, and its
+// pipelined requests are not run, until its backlog drains below this.
+const size_t SERVER_MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+const int SERVER_MAX_EVENTS = 256;
+
+volatile sig_atomic_t serverStopRequested = 0;
+
+extern "C" void requestServerStop(int)
+{
+    serverStopRequested = 1;
+}
+
+// Serves the batch command set over a stream socket, one epoll loop on one
+// thread. Requests and responses are frames (FRAME_HEADER_BYTES of length,
+// then the command or its JSON result); a client may pipeline any number
+// of requests and gets the responses back in order, one frame each, with
+// an empty frame for a blank or comment command. Commands are executed in
+// place in the connection's receive buffer, and the responses produced by
+// one read go out in a single send. Requests whose responses would push the
+// send buffer past SERVER_MAX_PENDING_OUTPUT wait in the receive buffer.
+class BookingServer
+{
+private:
+    struct Connection
+    {
+        int fd;
+        vector<char> input;
+        size_t inputUsed;
+        string output;
+        size_t outputSent;
+        StringAppendBuffer outputBuffer;
+        ostream outputStream;
+        BatchProcessor processor;
+        bool closing;
+        bool inputHeld; // complete frames wait in input for the backlog to drain
+
+        Connection(int f, BookingEngine &engine)
+            : fd(f), inputUsed(0), outputSent(0), outputBuffer(output), outputStream(&outputBuffer),
+              processor(engine, outputStream), closing(false), inputHeld(false) {}
+    };
+
+    BookingEngine &engine;
+    int listenFd;
+    int epollFd;
+    string unixPath;
+    unordered_map<int, unique_ptr<Connection>> connections;
+    long long requests;
+
+    static bool isBacklogged(const Connection &connection)
+    {
+        return connection.output.size() - connection.outputSent > SERVER_MAX_PENDING_OUTPUT;
+    }
+
+    void watch(Connection &connection)
+    {
+        epoll_event event{};
+        bool backlogged = isBacklogged(connection);
+        event.events = (backlogged || connection.closing ? 0u : uint32_t(EPOLLIN)) |
+                       (connection.outputSent < connection.output.size() ? uint32_t(EPOLLOUT) : 0u);
+        event.data.fd = connection.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    }
+
+    void closeConnection(int fd)
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    void acceptConnections()
+    {
+        while (true)
+        {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+            {
+                ::close(fd);
+                continue;
+            }
+            connections.emplace(fd, make_unique<Connection>(fd, engine));
+        }
+    }
+
+    // Runs the complete frames in the receive buffer, framing each result
+    // in the send buffer, and keeps any partial frame for the next read.
+    // Stops early once the send buffer is over SERVER_MAX_PENDING_OUTPUT, so
+    // one read of small requests with large responses cannot queue more than
+    // about one response past it; the rest run as the buffer drains.
+    void executeFrames(Connection &connection)
+    {
+        string_view pending(connection.input.data(), connection.inputUsed);
+        connection.inputHeld = false;
+        while (pending.size() >= FRAME_HEADER_BYTES)
+        {
+            if (isBacklogged(connection))
+            {
+                connection.inputHeld = true;
+                break;
+            }
+            uint32_t length = readFrameLength(pending.data());
+            if (length > MAX_FRAME_BYTES)
+            {
+                connection.closing = true;
+                break;
+            }
+            if (pending.size() < FRAME_HEADER_BYTES + length)
+                break;
+
+            size_t header = connection.output.size();
+            connection.output.append(FRAME_HEADER_BYTES, '\0');
+            connection.processor.execute(pending.substr(FRAME_HEADER_BYTES, length));
+            if (connection.output.size() > header + FRAME_HEADER_BYTES && connection.output.back() == '\n')
+                connection.output.pop_back();
+            writeFrameLength(&connection.output[header], static_cast<uint32_t>(connection.output.size() - header - FRAME_HEADER_BYTES));
+            pending.remove_prefix(FRAME_HEADER_BYTES + length);
+            requests++;
+        }
+        if (!pending.empty() && pending.data() != connection.input.data())
+            memmove(connection.input.data(), pending.data(), pending.size());
+        connection.inputUsed = pending.size();
+    }
+
+    // False once the connection is gone.
+    bool flush(Connection &connection)
+    {
+        while (connection.outputSent < connection.output.size())
+        {
+            ssize_t sent = send(connection.fd, connection.output.data() + connection.outputSent,
+                                connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            connection.outputSent += static_cast<size_t>(sent);
+        }
+        if (connection.outputSent == connection.output.size())
+        {
+            connection.output.clear();
+            connection.outputSent = 0;
+            if (connection.closing)
+                return false;
+        }
+        return true;
+    }
+
+    void handle(Connection &connection, uint32_t events)
+    {
+        if (events & EPOLLIN)
+        {
+            if (connection.input.size() < connection.inputUsed + SERVER_READ_CHUNK)
+                connection.input.resize(connection.inputUsed + SERVER_READ_CHUNK);
+            ssize_t received = recv(connection.fd, connection.input.data() + connection.inputUsed, SERVER_READ_CHUNK, 0);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                connection.closing = true;
+            else if (received > 0)
+            {
+                connection.inputUsed += static_cast<size_t>(received);
+                executeFrames(connection);
+            }
+        }
+        else if (events & (EPOLLERR | EPOLLHUP))
+        {
+            connection.closing = true;
+        }
+
+        while (true)
+        {
+            if (!flush(connection))
+            {
+                closeConnection(connection.fd);
+                return;
+            }
+            if (!connection.inputHeld || connection.closing || isBacklogged(connection))
+                break;
+            // Drop what has been sent so the buffer stays near the cap.
+            connection.output.erase(0, connection.outputSent);
+            connection.outputSent = 0;
+            executeFrames(connection);
+        }
+        watch(connection);
+    }
+
+public:
+    explicit BookingServer(BookingEngine &e) : engine(e), listenFd(-1), epollFd(-1), requests(0) {}
+
+    BookingServer(const BookingServer &) = delete;
+    BookingServer &operator=(const BookingServer &) = delete;
+
+    ~BookingServer()
+    {
+        for (auto &entry : connections)
+            ::close(entry.first);
+        if (epollFd >= 0)
+            ::close(epollFd);
+        if (listenFd >= 0)
+            ::close(listenFd);
+        if (!unixPath.empty())
+            ::unlink(unixPath.c_str());
+    }
+
+    long long getRequestCount() const { return requests; }
+
+    bool listen(const string &addressText)
+    {
+        sockaddr_storage address;
+        socklen_t length;
+        if (!parseSocketAddress(addressText, address, length))
+        {
+            cerr << "[System Error] Invalid server address: " << addressText << endl;
+            return false;
+        }
+        if (address.ss_family == AF_UNIX)
+        {
+            unixPath = reinterpret_cast<sockaddr_un &>(address).sun_path;
+            ::unlink(unixPath.c_str());
+        }
+
+        listenFd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int enable = 1;
+        if (listenFd >= 0 && address.ss_family == AF_INET)
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = listenFd;
+        if (listenFd < 0 || epollFd < 0 || bind(listenFd, reinterpret_cast<sockaddr *>(&address), length) != 0 ||
+            ::listen(listenFd, SOMAXCONN) != 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0)
+        {
+            cerr << "[System Error] Unable to listen on " << addressText << ": " << strerror(errno) << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Serves until SIGINT or SIGTERM.
+    void run()
+    {
+        struct sigaction action{};
+        action.sa_handler = requestServerStop;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+
+        epoll_event events[SERVER_MAX_EVENTS];
+        while (!serverStopRequested)
+        {
+            int ready = epoll_wait(epollFd, events, SERVER_MAX_EVENTS, 500);
+            for (int i = 0; i < ready; ++i)
+            {
+                if (events[i].data.fd == listenFd)
+                {
+                    acceptConnections();
+                    continue;
+                }
+                auto it = connections.find(events[i].data.fd);
+                if (it != connections.end())
+                    handle(*it->second, events[i].events);
+            }
+        }
+    }
+};
+#endif
+
+struct BenchmarkConfig
+{
+    int movies = 20000;
+    int theaters = 200;
+    int rows = 20;
+    int seatsPerRow = 25;
+    int showsPerTheater = 50;
+    int bookings = 1000000;
+    int seatsPerBooking = 2;
+    int repeats = 5;
+    int sessions = 1000;
+};
+
+// Per-operation latency samples for one benchmark, reported as JSON.
+class LatencyRecorder
+{
+private:
+    string name;
+    vector<uint64_t> samples;
+
+public:
+    explicit LatencyRecorder(const string &n) : name(n) {}
+
+    template <typename Operation>
+    void measure(Operation operation)
+    {
+        auto start = chrono::steady_clock::now();
+        operation();
+        samples.push_back(static_cast<uint64_t>(
+            chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count()));
+    }
+
+    void record(uint64_t nanoseconds) { samples.push_back(nanoseconds); }
+    void reserve(size_t count) { samples.reserve(count); }
+    void merge(const LatencyRecorder &other) { samples.insert(samples.end(), other.samples.begin(), other.samples.end()); }
+
+    // ops_per_sec is the inverse of the mean latency unless the operations
+    // overlapped, in which case pass the wall time they took between them.
+    void writeJson(ostream &out, double wallSeconds = 0)
+    {
+        sort(samples.begin(), samples.end());
+        uint64_t total = 0;
+        for (uint64_t sample : samples)
+            total += sample;
+        double opsPerSecond = (wallSeconds > 0 ? samples.size() / wallSeconds : (total ? samples.size() * 1e9 / total : 0));
+
+        auto percentile = [this](double p) -> uint64_t
+        {
+            if (samples.empty())
+                return 0;
+            size_t index = min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+            return samples[index];
+        };
+
+        out << "{\"name\":\"" << name << "\",\"ops\":" << samples.size()
+            << ",\"ops_per_sec\":" << static_cast<uint64_t>(opsPerSecond)
+            << ",\"mean_ns\":" << (samples.empty() ? 0 : total / samples.size())
+            << ",\"p50_ns\":" << percentile(0.50) << ",\"p99_ns\":" << percentile(0.99)
+            << ",\"p999_ns\":" << percentile(0.999)
+            << ",\"max_ns\":" << (samples.empty() ? 0 : samples.back()) << "}";
+    }
+};
+
+// Builds a synthetic chain in a scratch directory and times the booking,
+// cancel, persistence and occupancy/revenue paths.
+class BenchmarkSuite
+{
+private:
+    BenchmarkConfig config;
+    filesystem::path directory;
+    vector<LatencyRecorder> results;
+    int generatedBookings;
+    int transactions;
+    size_t arenaAllocations;
+    size_t arenaHeapAllocations;
+    int steadyTransactions;
+    size_t transactionHeapAllocations;
+
+    static constexpr const char *genres[] = {"Drama", "Sci-Fi/Action", "Romantic Drama", "Spy Thriller", "Mystery", "War Epic"};
+    static constexpr const char *languages[] = {"English", "Hindi", "Tamil", "Telugu", "Bengali"};
+
+    static string movieTitle(int m)
+    {
+        static const char *const words[] = {"Eternal", "Storm", "Shadow", "Voyage", "Quest", "Agent", "Desert", "Sun",
+                                            "Jungle", "Empire", "Silent", "River", "Crimson", "Last", "Night", "Signal"};
+        return string(words[m % 16]) + " " + words[(m / 16 + 5) % 16] + " " + to_string(m);
+    }
+
+    // Five shows a day from 10:00, over consecutive 28-day months of 2026.
+    static string showDate(int show)
+    {
+        int day = show / 5;
+        return "2026-" + string(day / 28 < 9 ? "0" : "") + to_string(day / 28 + 1) + "-" +
+               string(day % 28 < 9 ? "0" : "") + to_string(day % 28 + 1);
+    }
+
+    static string showTime(int show) { return to_string(10 + 3 * (show % 5)) + ":00"; }
+
+    void buildCatalog(BookingEngine &engine) const
+    {
+        vector<Movie *> movies;
+        for (int m = 0; m < config.movies; ++m)
+        {
+            movies.push_back(&engine.addMovie(movieTitle(m), genres[m % 6], 120, "Director " + to_string(m % 500), languages[m % 5]));
+        }
+
+        int premiumRows = config.rows / 5;
+        for (int t = 0; t < config.theaters; ++t)
+        {
+            Theater &theater = engine.addTheater("Bench Theater " + to_string(t), "City " + to_string(t % 50),
+                                                 "State " + to_string(t % 10), config.rows - premiumRows,
+                                                 premiumRows, config.seatsPerRow);
+            for (int show = 0; show < config.showsPerTheater; ++show)
+            {
+                engine.addShowtime(*movies[(t + show) % config.movies], theater, showTime(show), showDate(show));
+            }
+        }
+    }
+
+    // The same catalog as buildCatalog, as catalog files.
+    void writeCatalogFiles(const filesystem::path &catalogDirectory) const
+    {
+        filesystem::create_directories(catalogDirectory);
+        string movies, theaters, schedule;
+        for (int m = 0; m < config.movies; ++m)
+        {
+            movies += movieTitle(m) + "|" + genres[m % 6] + "|120|Director " + to_string(m % 500) + "|" + languages[m % 5] + "\n";
+        }
+        int premiumRows = config.rows / 5;
+        for (int t = 0; t < config.theaters; ++t)
+        {
+            string name = "Bench Theater " + to_string(t);
+            theaters += name + "|City " + to_string(t % 50) + "|State " + to_string(t % 10) + "|" +
+                        to_string(config.rows - premiumRows) + "|" + to_string(premiumRows) + "|" + to_string(config.seatsPerRow) + "\n";
+            for (int show = 0; show < config.showsPerTheater; ++show)
+            {
+                schedule += name + "|" + movieTitle((t + show) % config.movies) + "|" + showDate(show) + "|" + showTime(show) + "\n";
+            }
+        }
+        writeFileAtomically((catalogDirectory / MOVIES_FILE).string(), movies);
+        writeFileAtomically((catalogDirectory / THEATERS_FILE).string(), theaters);
+        writeFileAtomically((catalogDirectory / SCHEDULE_FILE).string(), schedule);
+    }
+
+    // Bookings in the text export format, filling each show's seats in order.
+    // Ids name their theater's shard, as the engine's own ids do.
+    string generateBookings(BookingEngine &catalog)
+    {
+        StableVector<Showtime> &showtimes = catalog.getShowtimes();
+        vector<int> nextSeat(showtimes.size(), 0);
+        vector<int> nextSerial(BOOKING_SHARDS, FIRST_BOOKING_ID / static_cast<int>(BOOKING_SHARDS) + 1);
+        string contents;
+        generatedBookings = 0;
+        for (int b = 0; b < config.bookings; ++b)
+        {
+            Showtime &show = showtimes[b % showtimes.size()];
+            const SeatLayout &layout = show.getTheater().getSeatLayout();
+            int &seat = nextSeat[show.getId()];
+            if (seat + config.seatsPerBooking > layout.getCapacity())
+                break;
+
+            size_t shard = show.getTheater().getId() % BOOKING_SHARDS;
+            contents += to_string(nextSerial[shard]++ * static_cast<int>(BOOKING_SHARDS) + static_cast<int>(shard));
+            contents += '|';
+            contents += show.getUniqueShowId();
+            contents += '|';
+            for (int k = 0; k < config.seatsPerBooking; ++k)
+            {
+                if (k)
+                    contents += ',';
+                contents += layout.getSeatId(seat++);
+            }
+            contents += '\n';
+            generatedBookings++;
+        }
+        return contents;
+    }
+
+    LatencyRecorder &addResult(const string &name)
+    {
+        results.emplace_back(name);
+        return results.back();
+    }
+
+public:
+    explicit BenchmarkSuite(const BenchmarkConfig &c)
+        : config(c), generatedBookings(0), transactions(0), arenaAllocations(0), arenaHeapAllocations(0),
+          steadyTransactions(0), transactionHeapAllocations(0)
+    {
+        directory = filesystem::temp_directory_path() / ("cinesphere-bench-" + to_string(chrono::steady_clock::now().time_since_epoch().count()));
+    }
+
+    ~BenchmarkSuite()
+    {
+        error_code ec;
+        filesystem::remove_all(directory, ec);
+    }
+
+    void run()
+    {
+        filesystem::create_directories(directory);
+        results.reserve(16);
+
+        {
+            filesystem::path catalogDirectory = directory / "catalog";
+            writeCatalogFiles(catalogDirectory);
+            BookingEngine engine(catalogDirectory.string(), false);
+            addResult("load_catalog_files").measure([&]() { engine.loadCatalog(catalogDirectory.string()); });
+        }
+
+        string bookingsText;
+        {
+            BookingEngine catalog(directory.string(), false);
+            buildCatalog(catalog);
+            catalog.loadBookingData();
+            bookingsText = generateBookings(catalog);
+        }
+        filesystem::remove(directory / BOOKING_SNAPSHOT_FILE);
+        filesystem::remove(directory / BOOKING_JOURNAL_FILE);
+        writeFileAtomically((directory / BOOKING_DATA_FILE).string(), bookingsText);
+        bookingsText.clear();
+
+        {
+            BookingEngine engine(directory.string(), false);
+            buildCatalog(engine);
+            addResult("load_booking_data_text").measure([&]() { engine.loadBookingData(); });
+
+            StableVector<Showtime> &showtimes = engine.getShowtimes();
+            FoodOrder emptyOrder;
+            LatencyRecorder &occupancy = addResult("calculate_occupancy_rate");
+            LatencyRecorder &revenue = addResult("calculate_total_revenue");
+            for (int pass = 0; pass < config.repeats; ++pass)
+            {
+                for (const Showtime &show : showtimes)
+                {
+                    volatile double sink = 0;
+                    volatile int64_t paiseSink = 0;
+                    occupancy.measure([&]() { sink = PriceCalculator::calculateOccupancyRate(show); });
+                    revenue.measure([&]() { paiseSink = PriceCalculator::calculateTotalRevenue(show, emptyOrder).getPaise(); });
+                }
+            }
+
+            // A few hundred rules compiled into per-show tables; a lookup
+            // sample is 1000 seat prices since one is below timer resolution.
+            vector<PricingRule> defaultRules = engine.getPricingRules();
+            vector<PricingRule> rules = defaultRules;
+            for (int r = 0; r < 200; ++r)
+            {
+                static const char *const templates[] = {"occupancy=%d seat=+1%%", "days=MON,WED,FRI from=%02d:00 to=23:00 seat=-1",
+                                                        "class=P rows=A-B seat=+%d", "promo=CODE%d order=-10"};
+                char text[96];
+                snprintf(text, sizeof(text), templates[r % 4], r % 4 == 1 ? r % 20 : r % 95 + 1);
+                PricingRule rule;
+                string error;
+                if (PricingEngine::parseRule("bench-" + to_string(r) + " " + text, rule, error))
+                    rules.push_back(rule);
+            }
+            addResult("pricing_recompile_all").measure([&]() { engine.setPricingRules(rules); });
+
+            LatencyRecorder &priceLookup = addResult("seat_price_lookup_x1000");
+            for (int pass = 0; pass < config.repeats; ++pass)
+            {
+                for (const Showtime &show : showtimes)
+                {
+                    const ShowPricing &table = show.getPricing();
+                    int rowCount = show.getTheater().getSeatLayout().getRowCount();
+                    volatile int64_t paiseSink = 0;
+                    priceLookup.measure([&]()
+                    {
+                        int64_t total = 0;
+                        for (int i = 0; i < 1000; ++i)
+                            total += table.getSeatPrice(i % rowCount, i % 101).getPaise();
+                        paiseSink = total;
+                    });
+                }
+            }
+            engine.setPricingRules(defaultRules);
+
+            // Title searches on slices of existing titles, and one day of
+            // showtimes from the start-time index.
+            const CatalogIndex &catalog = engine.getCatalog();
+            const StableVector<Movie> &movies = engine.getMovies();
+            LatencyRecorder &titleSearch = addResult("catalog_title_search");
+            LatencyRecorder &dateRange = addResult("catalog_shows_by_date");
+            for (int q = 0; q < 1000; ++q)
+            {
+                const string &title = movies[(static_cast<size_t>(q) * 7919) % movies.size()].getTitle();
+                string query = title.substr(q % 4, 6 + q % 5);
+                volatile size_t sink = 0;
+                titleSearch.measure([&]() { sink = catalog.findMovies(query).size(); });
+
+                int64_t day = CatalogIndex::startMinuteOf("2026-01-01", "00:00") + (q % 28) * 24 * 60;
+                dateRange.measure([&]() { sink = catalog.getShowtimesBetween(day, day + 24 * 60).size(); });
+            }
+
+            vector<vector<uint16_t>> seatSets(64);
+            for (size_t i = 0; i < seatSets.size(); ++i)
+            {
+                const SeatLayout &layout = showtimes[i % showtimes.size()].getTheater().getSeatLayout();
+                for (int k = 0; k < config.seatsPerBooking; ++k)
+                    seatSets[i].push_back(static_cast<uint16_t>((static_cast<int>(i) * 7 + k) % layout.getCapacity()));
+            }
+            LatencyRecorder &rollup = addResult("analytics_rollup_state");
+            for (int pass = 0; pass < config.repeats; ++pass)
+            {
+                rollup.measure([&]() { AnalyticsEngine(engine).rollup(ReportDimension::STATE); });
+            }
+
+            LatencyRecorder &construct = addResult("booking_construct");
+            for (int b = 0; b < generatedBookings; ++b)
+            {
+                Showtime &show = showtimes[b % showtimes.size()];
+                const vector<uint16_t> &seats = seatSets[b % seatSets.size()];
+                construct.measure([&]() { Booking booking(FIRST_BOOKING_ID + b, show, seats, emptyOrder); });
+            }
+
+            LatencyRecorder &save = addResult("save_booking_data");
+            for (int pass = 0; pass < config.repeats; ++pass)
+            {
+                save.measure([&]() { engine.waitUntilDurable(engine.saveBookingData()); });
+            }
+        }
+
+        {
+            BookingEngine engine(directory.string(), false);
+            buildCatalog(engine);
+            addResult("load_booking_data_snapshot").measure([&]() { engine.loadBookingData(); });
+
+            // Each cancel goes through the engine: shard lookup and lock, seat
+            // release, counters, store and journal record.
+            vector<int> bookingIds;
+            for (const Booking &booking : engine.listBookings())
+            {
+                bookingIds.push_back(booking.getId());
+            }
+            LatencyRecorder &cancel = addResult("booking_cancel");
+            cancel.reserve(bookingIds.size());
+            for (int bookingId : bookingIds)
+            {
+                cancel.measure([&]() { engine.cancelBooking(bookingId); });
+            }
+
+            // Hold, confirm and cancel through a transaction arena; the arena
+            // counters show whether any scratch allocation reached the heap.
+            StableVector<Showtime> &showtimes = engine.getShowtimes();
+            TransactionArena arena;
+            int capacity = showtimes.front().getTheater().getCapacity();
+            vector<int> seatIndices(min(config.seatsPerBooking, capacity));
+            iota(seatIndices.begin(), seatIndices.end(), capacity - static_cast<int>(seatIndices.size()));
+            FoodOrder emptyOrder;
+            LatencyRecorder &transaction = addResult("booking_transaction");
+            transactions = min(generatedBookings, 10000);
+            transaction.reserve(transactions);
+            // Global operator new calls are counted once every showtime has
+            // had a hold, since a show's first hold allocates its hold tags.
+            int warmup = min(transactions, static_cast<int>(showtimes.size()));
+            size_t heapBefore = 0;
+            for (int t = 0; t < transactions; ++t)
+            {
+                if (t == warmup)
+                    heapBefore = threadHeapAllocations;
+                arena.reset();
+                ShowtimeId showId = showtimes[t % showtimes.size()].getId();
+                optional<Booking> booking;
+                transaction.measure([&]()
+                {
+                    uint32_t token = engine.openSession();
+                    if (engine.holdSeats(showId, seatIndices, token, SEAT_HOLD_SECONDS, arena.resource()))
+                        booking = engine.confirmBooking(showId, seatIndices, token, emptyOrder, {}, arena.resource());
+                });
+                if (booking)
+                    engine.cancelBooking(booking->getId());
+            }
+            if (warmup < transactions)
+                transactionHeapAllocations = threadHeapAllocations - heapBefore;
+            steadyTransactions = transactions - warmup;
+            arenaAllocations = arena.getAllocationCount();
+            arenaHeapAllocations = arena.getHeapAllocationCount();
+        }
+
+        // Many console dialogs in flight at once on one thread: every session
+        // books two seats, and each step of every session is one sample.
+        {
+            filesystem::path sessionDirectory = directory / "sessions";
+            filesystem::create_directories(sessionDirectory);
+            BookingEngine engine(sessionDirectory.string(), false);
+            buildCatalog(engine);
+            engine.loadBookingData();
+
+            SessionLoop loop(engine);
+            vector<uint32_t> ids;
+            for (int s = 0; s < config.sessions; ++s)
+            {
+                ids.push_back(loop.open());
+                loop.takeOutput(ids.back());
+            }
+
+            const vector<string> script = {"1", "1", "1", "1", "N", "", "BEST", "2", "S", "DONE", "0", "", "", "3"};
+            LatencyRecorder &step = addResult("session_dialog_step");
+            for (size_t line = 0; line < script.size(); ++line)
+            {
+                for (int s = 0; s < config.sessions; ++s)
+                {
+                    uint32_t id = ids[s];
+                    if (loop.isFinished(id))
+                        continue;
+                    string input = line == 5 ? to_string(1 + s % config.showsPerTheater) : script[line];
+                    step.measure([&]() { loop.feed(id, move(input)); });
+                    loop.takeOutput(id);
+                }
+            }
+            for (uint32_t id : ids)
+            {
+                if (!loop.isFinished(id))
+                    loop.close(id);
+            }
+        }
+    }
+
+    void writeJson(ostream &out)
+    {
+        out << "{\"config\":{\"movies\":" << config.movies << ",\"theaters\":" << config.theaters << ",\"rows\":" << config.rows
+            << ",\"seats_per_row\":" << config.seatsPerRow << ",\"shows_per_theater\":" << config.showsPerTheater
+            << ",\"bookings\":" << generatedBookings << ",\"seats_per_booking\":" << config.seatsPerBooking
+            << ",\"repeats\":" << config.repeats << ",\"sessions\":" << config.sessions << "},\"arena\":{\"transactions\":" << transactions
+            << ",\"allocations\":" << arenaAllocations << ",\"heap_allocations\":" << arenaHeapAllocations
+            << ",\"steady_transactions\":" << steadyTransactions << ",\"operator_new\":" << transactionHeapAllocations
+            << "},\"results\":[";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            out << (i ? ",\n" : "\n");
+            results[i].writeJson(out);
+        }
+        out << "\n]}\n";
+    }
+};
+
+#ifdef __linux__
+struct LoadConfig
+{
+    string address;
+    int connections = 8;
+    int requests = 100000;
+    int pipeline = 16;
+};
+
+// Load generator for BookingServer. Each connection runs on its own thread
+// and keeps `pipeline` requests in flight: mostly OCCUPANCY queries, every
+// eighth a BEST booking, and a CANCEL for each booking made, so a long run
+// does not fill the chain. Latency is measured from queueing a request to
+// reading its response.
+class LoadGenerator
+{
+private:
+    LoadConfig config;
+    int showCount;
+    LatencyRecorder latency;
+    long long failures;
+    double seconds;
+    mutex resultsMutex;
+
+    // Blocking connection that reads whole response frames.
+    class Client
+    {
+    private:
+        int fd;
+        string received;
+        size_t consumed;
+
+    public:
+        explicit Client(const string &addressText) : fd(-1), consumed(0)
+        {
+            sockaddr_storage address;
+            socklen_t length;
+            if (!parseSocketAddress(addressText, address, length))
+                throw invalid_argument("invalid server address " + addressText);
+            fd = socket(address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), length) != 0)
+            {
+                string error = strerror(errno);
+                if (fd >= 0)
+                    ::close(fd);
+                throw runtime_error("unable to connect to " + addressText + ": " + error);
+            }
+            int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+
+        Client(const Client &) = delete;
+        Client &operator=(const Client &) = delete;
+        ~Client() { ::close(fd); }
+
+        static void appendFrame(string &out, string_view payload)
+        {
+            size_t header = out.size();
+            out.append(FRAME_HEADER_BYTES, '\0');
+            writeFrameLength(&out[header], static_cast<uint32_t>(payload.size()));
+            out.append(payload);
+        }
+
+        void sendAll(string_view data)
+        {
+            while (!data.empty())
+            {
+                ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent <= 0)
+                    throw runtime_error("server closed the connection");
+                data.remove_prefix(static_cast<size_t>(sent));
+            }
+        }
+
+        // The next response; valid until the next call.
+        string_view readFrame()
+        {
+            while (true)
+            {
+                size_t available = received.size() - consumed;
+                if (available >= FRAME_HEADER_BYTES)
+                {
+                    uint32_t length = readFrameLength(received.data() + consumed);
+                    if (available >= FRAME_HEADER_BYTES + length)
+                    {
+                        string_view frame(received.data() + consumed + FRAME_HEADER_BYTES, length);
+                        consumed += FRAME_HEADER_BYTES + length;
+                        return frame;
+                    }
+                }
+                received.erase(0, consumed);
+                consumed = 0;
+
+                char chunk[16 * 1024];
+                ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+                if (count < 0 && errno == EINTR)
+                    continue;
+                if (count <= 0)
+                    throw runtime_error("server closed the connection");
+                received.append(chunk, static_cast<size_t>(count));
+            }
+        }
+    };
+
+    void runConnection(int connectionIndex, int quota)
+    {
+        Client client(config.address);
+        LatencyRecorder local("request");
+        long long localFailures = 0;
+        deque<chrono::steady_clock::time_point> inFlight;
+        vector<int> bookingsToCancel;
+        string outgoing;
+        int issued = 0;
+
+        for (int completed = 0; completed < quota; ++completed)
+        {
+            outgoing.clear();
+            while (issued < quota && (int)inFlight.size() < config.pipeline)
+            {
+                int show = (issued * 7 + connectionIndex) % showCount;
+                string request;
+                if (!bookingsToCancel.empty())
+                {
+                    request = "CANCEL " + to_string(bookingsToCancel.back());
+                    bookingsToCancel.pop_back();
+                }
+                else if (issued % 8 == 0)
+                    request = "BEST " + to_string(show) + " 2 S";
+                else
+                    request = "OCCUPANCY " + to_string(show);
+                Client::appendFrame(outgoing, request);
+                inFlight.push_back(chrono::steady_clock::now());
+                issued++;
+            }
+            client.sendAll(outgoing);
+
+            string_view response = client.readFrame();
+            local.record(static_cast<uint64_t>(
+                chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - inFlight.front()).count()));
+            inFlight.pop_front();
+
+            if (response.find("\"ok\":true") == string_view::npos)
+                localFailures++;
+            else if (response.find("\"op\":\"BEST\"") != string_view::npos)
+            {
+                string_view idText = response.substr(response.find("\"booking\":") + 10);
+                int bookingId;
+                if (from_chars(idText.data(), idText.data() + idText.size(), bookingId).ec == errc())
+                    bookingsToCancel.push_back(bookingId);
+            }
+        }
+
+        lock_guard<mutex> lock(resultsMutex);
+        latency.merge(local);
+        failures += localFailures;
+    }
+
+public:
+    explicit LoadGenerator(const LoadConfig &c) : config(c), showCount(0), latency("request"), failures(0), seconds(0) {}
+
+    void run()
+    {
+        {
+            Client client(config.address);
+            string request;
+            Client::appendFrame(request, "SHOWS");
+            client.sendAll(request);
+            string_view shows = client.readFrame();
+            for (size_t pos = shows.find("{\"id\":"); pos != string_view::npos; pos = shows.find("{\"id\":", pos + 1))
+                showCount++;
+            if (showCount == 0)
+                throw runtime_error("server has no showtimes");
+        }
+
+        vector<thread> workers;
+        auto start = chrono::steady_clock::now();
+        for (int c = 0; c < config.connections; ++c)
+        {
+            int quota = config.requests / config.connections + (c < config.requests % config.connections ? 1 : 0);
+            workers.emplace_back([this, c, quota]()
+            {
+                try
+                {
+                    runConnection(c, quota);
+                }
+                catch (const std::exception &e)
+                {
+                    cerr << "[System Error] Load connection " << c << ": " << e.what() << endl;
+                }
+            });
+        }
+        for (thread &worker : workers)
+            worker.join();
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    void writeJson(ostream &out)
+    {
+        out << "{\"config\":{\"address\":\"" << jsonEscape(config.address) << "\",\"connections\":" << config.connections
+            << ",\"pipeline\":" << config.pipeline << ",\"requests\":" << config.requests
+            << "},\"showtimes\":" << showCount << ",\"seconds\":" << formatNumber(seconds)
+            << ",\"requests_per_sec\":" << (seconds > 0 ? static_cast<uint64_t>(config.requests / seconds) : 0)
+            << ",\"failures\":" << failures << ",\"results\":[\n";
+        // Requests overlap across connections and the pipeline, so their
+        // rate comes from the run's wall time.
+        latency.writeJson(out, seconds);
+        out << "\n]}\n";
+    }
+};
+#endif
+
+class SystemManager
+{
+private:
+    BookingEngine engine;
+
+public:
+    // Runs a command stream without any prompts; see BatchProcessor.
+    void runBatch(istream &in, ostream &out, bool framed)
+    {
+        BatchProcessor processor(engine, out);
+        processor.run(in, framed);
+        out.flush();
+        cerr << "Batch complete: " << processor.getProcessedCount() << " commands, "
+             << processor.getFailureCount() << " failed." << endl;
+    }
+
+#ifdef __linux__
+    // Serves the batch commands on a socket until interrupted; see BookingServer.
+    bool runServer(const string &address)
+    {
+        BookingServer server(engine);
+        if (!server.listen(address))
+            return false;
+        cerr << "Serving on " << address << "; press Ctrl+C to stop." << endl;
+        server.run();
+        cerr << "Server stopped after " << server.getRequestCount() << " requests." << endl;
+        return true;
+    }
+#endif
+
+    // Runs one dialog against the console: every line typed is fed to the
+    // session and whatever it prints is shown before the next read.
+    void runBookingProcess()
+    {
+        SessionLoop sessions(engine);
+        uint32_t id = sessions.open();
+        string line;
+        while (true)
+        {
+            cout << sessions.takeOutput(id) << flush;
+            if (sessions.isFinished(id))
+                break;
+            if (getline(cin, line))
+                sessions.feed(id, move(line));
+            else
+                sessions.close(id);
+        }
+    }
+};
+
+// Writes the per-stage latency histograms as one JSON object.
+void writeMetricsFile(const string &path)
+{
+    ofstream outFile(path);
+    if (!outFile.is_open())
+    {
+        cerr << "[System Error] Unable to write metrics to " << path << endl;
+        return;
+    }
+    StageMetrics::instance().writeJson(outFile);
+    outFile << "\n";
+}
+
+int runBatchMode(int argc, char *argv[])
+{
+    string inputPath = "-";
+    string outputPath = "-";
+    string metricsPath;
+    bool framed = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--framed")
+            framed = true;
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (arg == "--metrics" && i + 1 < argc)
+            metricsPath = argv[++i];
+        else
+            inputPath = arg;
+    }
+
+    ifstream inFile;
+    if (inputPath != "-")
+    {
+        inFile.open(inputPath, ios::binary);
+        if (!inFile.is_open())
+        {
+            cerr << "Unable to open batch file: " << inputPath << endl;
+            return 1;
+        }
+    }
+    ofstream outFile;
+    if (outputPath != "-")
+    {
+        outFile.open(outputPath);
+        if (!outFile.is_open())
+        {
+            cerr << "Unable to open output file: " << outputPath << endl;
+            return 1;
+        }
+    }
+
+    ios::sync_with_stdio(false);
+    {
+        SystemManager system;
+        system.runBatch(inputPath == "-" ? cin : inFile, outputPath == "-" ? cout : outFile, framed);
+    }
+    if (!metricsPath.empty())
+        writeMetricsFile(metricsPath);
+    return 0;
+}
+
+int runServerMode(int argc, char *argv[])
+{
+#ifdef __linux__
+    string address;
+    string metricsPath;
+    for (int i = 2; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--metrics" && i + 1 < argc)
+            metricsPath = argv[++i];
+        else
+            address = arg;
+    }
+    if (address.empty())
+    {
+        cerr << "Usage: --serve <unix:path | [host:]port> [--metrics metrics.json]" << endl;
+        return 1;
+    }
+
+    {
+        SystemManager system;
+        if (!system.runServer(address))
+            return 1;
+    }
+    if (!metricsPath.empty())
+        writeMetricsFile(metricsPath);
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    cerr << "Server mode needs epoll and is only available on Linux." << endl;
+    return 1;
+#endif
+}
+
+int runLoadMode(int argc, char *argv[])
+{
+#ifdef __linux__
+    LoadConfig config;
+    string outputPath = "-";
+    if (argc > 2)
+        config.address = argv[2];
+    for (int i = 3; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        if (option == "--output")
+        {
+            outputPath = argv[i + 1];
+            continue;
+        }
+
+        int value = atoi(argv[i + 1]);
+        if (option == "--connections")
+            config.connections = value;
+        else if (option == "--requests")
+            config.requests = value;
+        else if (option == "--pipeline")
+            config.pipeline = value;
+        else
+        {
+            cerr << "Unknown load option: " << option << endl;
+            return 1;
+        }
+    }
+    if (config.address.empty() || config.connections <= 0 || config.requests <= 0 || config.pipeline <= 0)
+    {
+        cerr << "Usage: --load <unix:path | [host:]port> [--connections 8] [--requests 100000] [--pipeline 16]" << endl;
+        return 1;
+    }
+
+    try
+    {
+        LoadGenerator generator(config);
+        generator.run();
+        if (outputPath == "-")
+        {
+            generator.writeJson(cout);
+        }
+        else
+        {
+            ofstream outFile(outputPath);
+            generator.writeJson(outFile);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        cerr << "Load run failed: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    cerr << "Load mode needs the Linux socket server." << endl;
+    return 1;
+#endif
+}
+
+int runBenchmarkMode(int argc, char *argv[])
+{
+    BenchmarkConfig config;
+    string outputPath = "-";
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        if (option == "--output")
+        {
+            outputPath = argv[i + 1];
+            continue;
+        }
+
+        int64_t number;
+        if (!parseWholeNumber(argv[i + 1], number) || number < 0 || number > numeric_limits<int>::max())
+        {
+            cerr << "Invalid value for " << option << ": " << argv[i + 1] << endl;
+            return 1;
+        }
+        int value = static_cast<int>(number);
+        if (option == "--movies")
+            config.movies = value;
+        else if (option == "--theaters")
+            config.theaters = value;
+        else if (option == "--rows")
+            config.rows = value;
+        else if (option == "--seats")
+            config.seatsPerRow = value;
+        else if (option == "--shows")
+            config.showsPerTheater = value;
+        else if (option == "--bookings")
+            config.bookings = value;
+        else if (option == "--seats-per-booking")
+            config.seatsPerBooking = value;
+        else if (option == "--repeats")
+            config.repeats = value;
+        else if (option == "--sessions")
+            config.sessions = value;
+        else
+        {
+            cerr << "Unknown benchmark option: " << option << endl;
+            return 1;
+        }
+    }
+    if (config.movies <= 0 || config.theaters <= 0 || config.showsPerTheater <= 0 || config.seatsPerBooking <= 0)
+    {
+        cerr << "Benchmark needs at least one movie, theater, show and seat per booking." << endl;
+        return 1;
+    }
+    // The limits the catalog loader puts on theaters.txt.
+    if (config.rows <= 0 || config.rows > 26 || config.seatsPerRow <= 0 || config.seatsPerRow > 99)
+    {
+        cerr << "Benchmark theaters need 1-26 rows of 1-99 seats." << endl;
+        return 1;
+    }
+
+    try
+    {
+        BenchmarkSuite suite(config);
+        suite.run();
+        if (outputPath == "-")
+        {
+            suite.writeJson(cout);
+        }
+        else
+        {
+            ofstream outFile(outputPath);
+            suite.writeJson(outFile);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        cerr << "Benchmark failed: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && string(argv[1]) == "--batch")
+    {
+        return runBatchMode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench")
+    {
+        return runBenchmarkMode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--serve")
+    {
+        return runServerMode(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--load")
+    {
+        return runLoadMode(argc, argv);
+    }
+    string metricsPath;
+    if (argc > 2 && string(argv[1]) == "--metrics")
+    {
+        metricsPath = argv[2];
+    }
+
+    cout << fixed << setprecision(2);
+
+    cout << LINE_SEPARATOR << endl;
+    cout << APP_NAME << " - C++ OOP Console Project" << endl;
+    cout << "Welcome to the world-class movie booking experience." << endl;
+    cout << "Demonstrating: Encapsulation, Inheritance, Polymorphism, Abstraction," << endl;
+    cout << "               Friend Functions, Friend Classes, Virtual Functions" << endl;
+    cout << LINE_SEPARATOR << endl;
+
+    {
+        SystemManager system;
+
+        system.runBookingProcess();
+    }
+
+    cout << "\n"
+         << LINE_SEPARATOR << endl;
+    cout << "Application Session Ended. All current bookings have been saved to " << BOOKING_DATA_FILE << endl;
+    cout << LINE_SEPARATOR << endl;
+    if (!metricsPath.empty())
+        writeMetricsFile(metricsPath);
+
+    return 0;
+}
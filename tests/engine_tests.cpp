@@ -0,0 +1,302 @@
+// Engine tests: the hold/confirm race, the booking record codec, replaying
+// a journal over a newer snapshot, hold expiry, and restoring a snapshot
+// after the schedule changed. Built against the
+// program itself, with its main renamed:
+//
+//   g++ -std=c++20 -O2 -pthread tests/engine_tests.cpp -o engine_tests
+//   ./engine_tests
+//
+// Exits with status 1 if any check fails.
+
+#define main projectMain
+#include "../project.cpp"
+#undef main
+
+int checksRun = 0;
+int checksFailed = 0;
+
+void check(bool passed, const string &what)
+{
+    checksRun++;
+    if (!passed)
+    {
+        checksFailed++;
+        cout << "FAILED: " << what << endl;
+    }
+}
+
+// An empty data directory, removed when the test ends.
+class ScratchDirectory
+{
+private:
+    filesystem::path path;
+
+public:
+    explicit ScratchDirectory(const string &name)
+    {
+        auto stamp = chrono::steady_clock::now().time_since_epoch().count();
+        path = filesystem::temp_directory_path() / ("engine_tests_" + name + "_" + to_string(stamp));
+        filesystem::create_directories(path);
+    }
+
+    ~ScratchDirectory()
+    {
+        error_code ec;
+        filesystem::remove_all(path, ec);
+    }
+
+    const filesystem::path &get() const { return path; }
+};
+
+// Threads race to hold and book overlapping pairs of seats on one show.
+// Every seat must end up booked by exactly one booking, and the show's
+// counters must agree with its seats.
+void testHoldConfirmRace()
+{
+    ScratchDirectory directory("race");
+    BookingEngine engine(directory.get().string());
+    Showtime &show = *engine.getShowtime(0);
+    int capacity = show.getTheater().getCapacity();
+
+    const int threadCount = 8;
+    vector<int> seatsBooked(threadCount, 0);
+    vector<thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            FoodOrder noFood;
+            for (int seat = t % 2; seat + 1 < capacity; ++seat)
+            {
+                vector<int> pair = {seat, seat + 1};
+                uint32_t token = engine.openSession();
+                if (!engine.holdSeats(show.getId(), pair, token))
+                    continue;
+                if (engine.confirmBooking(show.getId(), pair, token, noFood))
+                    seatsBooked[t] += 2;
+                else
+                    engine.releaseSeats(show.getId(), pair, token);
+            }
+        });
+    }
+    for (thread &worker : threads)
+    {
+        worker.join();
+    }
+
+    int confirmed = accumulate(seatsBooked.begin(), seatsBooked.end(), 0);
+    int booked = show.getSeatInventory().countBooked();
+    check(confirmed > 0, "race: some pairs are booked");
+    check(confirmed == booked, "race: each booked seat belongs to exactly one booking (" + to_string(confirmed) +
+                                   " confirmed, " + to_string(booked) + " booked)");
+    check(show.getCounters().bookedSeats() == booked, "race: show counters match its seats");
+}
+
+// Records of varied sizes survive an encode and decode unchanged, in order,
+// across the deltas the codec takes between them.
+void testCodecRoundTrip()
+{
+    vector<vector<uint16_t>> seats = {{0}, {5, 6, 7}, {}, {499, 3, 250}};
+    vector<vector<FoodLine>> food = {{}, {{2, 1}, {0, 3}}, {{7, 65535}}, {}};
+    vector<BookingRecord> records;
+    for (size_t i = 0; i < seats.size(); ++i)
+    {
+        BookingRecord record;
+        record.bookingId = static_cast<int32_t>(5001 + i * i * 1000);
+        record.showtimeId = static_cast<ShowtimeId>((i * 7) % 3);
+        record.seats = seats[i];
+        record.food = food[i];
+        record.ticketPaise = static_cast<int32_t>(i * 45000);
+        record.foodPaise = static_cast<int32_t>(i * 1250);
+        record.discountPaise = (i == 1 ? -500 : 0);
+        records.push_back(record);
+    }
+
+    string encoded;
+    BookingRecordCodec encoder;
+    for (const BookingRecord &record : records)
+    {
+        encoder.encode(record, encoded);
+    }
+
+    BookingRecordCodec decoder;
+    const char *pos = encoded.data();
+    const char *end = pos + encoded.size();
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        BookingRecord decoded;
+        string label = "codec: record " + to_string(i);
+        if (!decoder.decode(pos, end, decoded))
+        {
+            check(false, label + " decodes");
+            return;
+        }
+        const BookingRecord &original = records[i];
+        check(decoded.bookingId == original.bookingId && decoded.showtimeId == original.showtimeId, label + " keeps its ids");
+        check(equal(decoded.seats.begin(), decoded.seats.end(), original.seats.begin(), original.seats.end()),
+              label + " keeps its seats");
+        check(decoded.food.size() == original.food.size() &&
+                  equal(decoded.food.begin(), decoded.food.end(), original.food.begin(),
+                        [](const FoodLine &a, const FoodLine &b) { return a.itemId == b.itemId && a.quantity == b.quantity; }),
+              label + " keeps its food lines");
+        check(decoded.ticketPaise == original.ticketPaise && decoded.foodPaise == original.foodPaise &&
+                  decoded.discountPaise == original.discountPaise,
+              label + " keeps its totals");
+    }
+    check(pos == end, "codec: decoding consumes the whole stream");
+}
+
+// A crash after a snapshot is written but before the journal it replaces is
+// deleted leaves records the snapshot already holds. Replaying them must
+// not bring back a cancelled booking or free a rebooked seat.
+void testCrashReplay()
+{
+    ScratchDirectory directory("replay");
+    filesystem::path journalPath = directory.get() / BOOKING_JOURNAL_FILE;
+    filesystem::path savedJournal = directory.get() / "saved.journal";
+    vector<int> seat = {0};
+    int first, second;
+    {
+        BookingEngine engine(directory.get().string());
+        FoodOrder noFood;
+        uint32_t token = engine.openSession();
+        engine.holdSeats(0, seat, token);
+        first = engine.confirmBooking(0, seat, token, noFood)->getId();
+        engine.cancelBooking(first);
+        token = engine.openSession();
+        engine.holdSeats(0, seat, token);
+        second = engine.confirmBooking(0, seat, token, noFood)->getId();
+        while (engine.getDurableSequence() < 3)
+        {
+            this_thread::yield();
+        }
+        filesystem::copy_file(journalPath, savedJournal);
+    }
+    // Shutdown wrote a snapshot holding all three records; put their
+    // journal back as if the crash came before it was removed.
+    filesystem::copy_file(savedJournal, journalPath, filesystem::copy_options::overwrite_existing);
+
+    BookingEngine engine(directory.get().string());
+    check(!engine.bookingExists(first), "replay: the cancelled booking stays cancelled");
+    check(engine.bookingExists(second), "replay: the later booking is kept");
+    check(engine.getShowtime(0)->getSeatInventory().getStatus(0, 0) == Seat::BOOKED, "replay: its seat stays booked");
+    check(engine.getShowtime(0)->getCounters().bookings.load() == 1, "replay: the show counts one booking");
+}
+
+// A hold that is never confirmed is released by the reaper once it expires,
+// and its token can no longer confirm the seat.
+void testHoldExpiry()
+{
+    ScratchDirectory directory("expiry");
+    BookingEngine engine(directory.get().string());
+    SeatInventory &seats = engine.getShowtime(0)->getSeatInventory();
+    vector<int> seat = {0};
+    uint32_t token = engine.openSession();
+
+    check(engine.holdSeats(0, seat, token, 1), "expiry: the seat is held");
+    check(seats.getStatus(0, 0) == Seat::SELECTED, "expiry: the seat shows as selected while held");
+    check(!engine.holdSeats(0, seat, engine.openSession()), "expiry: another session cannot hold it meanwhile");
+
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+    while (seats.getStatus(0, 0) != Seat::AVAILABLE && chrono::steady_clock::now() < deadline)
+    {
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    check(seats.getStatus(0, 0) == Seat::AVAILABLE, "expiry: the reaper frees the seat");
+    FoodOrder noFood;
+    check(!engine.confirmBooking(0, seat, token, noFood), "expiry: the expired token cannot confirm");
+    check(engine.holdSeats(0, seat, engine.openSession()), "expiry: another session can hold the seat");
+}
+
+void writeCatalog(const filesystem::path &directory, const string &theaters, const string &schedule)
+{
+    writeFileAtomically((directory / MOVIES_FILE).string(), "Test Movie|Drama|120|Test Director|English\n");
+    writeFileAtomically((directory / THEATERS_FILE).string(), theaters);
+    writeFileAtomically((directory / MENUS_FILE).string(), "*|Popcorn|150|Snacks\n");
+    writeFileAtomically((directory / SCHEDULE_FILE).string(), schedule);
+}
+
+Showtime *findShow(BookingEngine &engine, const string &theater, const string &time)
+{
+    StableVector<Showtime> &showtimes = engine.getShowtimes();
+    for (size_t i = 0; i < showtimes.size(); ++i)
+    {
+        if (showtimes[i].getTheater().getName() == theater && showtimes[i].getTime() == time)
+            return &showtimes[i];
+    }
+    return nullptr;
+}
+
+// A show added to the schedule ahead of a booked one, a show dropped from
+// it and theaters listed in a new order all renumber the showtimes. The
+// snapshot must still restore the kept show's booking with its food, and
+// give the new show none of the dropped show's seats.
+void testScheduleChange()
+{
+    ScratchDirectory directory("schedule");
+    const string hallOne = "Hall One|City|State|4|1|10\n";
+    const string hallTwo = "Hall Two|City|State|4|1|10\n";
+    writeCatalog(directory.get(), hallOne + hallTwo,
+                 "Hall One|Test Movie|2026-05-01|10:00\n"
+                 "Hall Two|Test Movie|2026-05-01|18:00\n");
+    vector<int> seats = {0, 1};
+    int dropped, kept;
+    Money revenue;
+    {
+        BookingEngine engine(directory.get().string());
+        Showtime *first = findShow(engine, "Hall One", "10:00");
+        Showtime *second = findShow(engine, "Hall Two", "18:00");
+        if (!first || !second)
+        {
+            check(false, "schedule: the catalog loads");
+            return;
+        }
+        FoodOrder noFood, food;
+        food.addItem(second->getTheater().getMenu().front(), 2);
+        uint32_t token = engine.openSession();
+        engine.holdSeats(first->getId(), seats, token);
+        dropped = engine.confirmBooking(first->getId(), seats, token, noFood)->getId();
+        token = engine.openSession();
+        engine.holdSeats(second->getId(), seats, token);
+        kept = engine.confirmBooking(second->getId(), seats, token, food)->getId();
+        revenue = second->getCounters().netRevenue();
+    }
+
+    writeCatalog(directory.get(), hallTwo + hallOne,
+                 "Hall One|Test Movie|2026-05-01|13:00\n"
+                 "Hall Two|Test Movie|2026-05-01|18:00\n");
+    BookingEngine engine(directory.get().string());
+    Showtime *added = findShow(engine, "Hall One", "13:00");
+    Showtime *second = findShow(engine, "Hall Two", "18:00");
+    if (!added || !second)
+    {
+        check(false, "schedule: the changed catalog loads");
+        return;
+    }
+    check(engine.bookingExists(kept), "schedule: the kept show's booking is restored");
+    check(!engine.bookingExists(dropped), "schedule: the dropped show's booking is not");
+    check(second->getSeatInventory().getStatus(0, 0) == Seat::BOOKED, "schedule: the kept show's seats stay booked");
+    check(second->getCounters().netRevenue() == revenue && second->getCounters().foodRevenue() > Money(),
+          "schedule: the kept show keeps its billed totals and food");
+    check(added->getSeatInventory().countBooked() == 0 && added->getCounters().bookings.load() == 0,
+          "schedule: the added show starts empty");
+
+    FoodOrder noFood;
+    vector<int> seat = {2};
+    uint32_t token = engine.openSession();
+    engine.holdSeats(second->getId(), seat, token);
+    optional<Booking> next = engine.confirmBooking(second->getId(), seat, token, noFood);
+    check(next && engine.bookingExists(kept) && next->getId() != kept, "schedule: new bookings get fresh ids");
+}
+
+int main()
+{
+    testHoldConfirmRace();
+    testCodecRoundTrip();
+    testCrashReplay();
+    testHoldExpiry();
+    testScheduleChange();
+
+    cout << (checksRun - checksFailed) << " of " << checksRun << " checks passed" << endl;
+    return checksFailed == 0 ? 0 : 1;
+}